@@ -39,6 +39,7 @@
 #include "ctl.h"
 #include "downloads.h"
 #include "fileinfo.h"
+#include "gnet_stats.h"
 #include "gnutella.h"
 #include "guid.h"
 #include "hcache.h"
@@ -72,6 +73,7 @@
 #include "lib/hstrfn.h"
 #include "lib/htable.h"
 #include "lib/parse.h"
+#include "lib/prof.h"
 #include "lib/pslist.h"
 #include "lib/shuffle.h"
 #include "lib/str.h"
@@ -97,7 +99,9 @@ static hikset_t *mesh = NULL;
 struct dmesh {				/**< A download mesh bucket */
 	list_t *entries;		/**< The download mesh entries, dmesh_entry data */
 	htable_t *by_host;		/**< Entries indexed by host (IP:port) */
-	htable_t *by_guid;		/**< Entries indexed by GUID (firewalled entries) */
+	htable_t *by_guid;		/**< Entries indexed by GUID (firewalled entries),
+								 created on demand since most meshes only
+								 hold non-firewalled sources */
 	time_t last_update;		/**< Timestamp of last insert/expire in the mesh */
 	const sha1_t *sha1;		/**< The SHA1 of this mesh */
 };
@@ -117,6 +121,7 @@ struct dmesh_entry {
 #define MAX_LIFETIME	43200		/**< half a day */
 #define MAX_LIBLIFETIME	3600		/**< 1 hour for shared/seeded files */
 #define MAX_ENTRIES		256			/**< Max amount of entries kept per SHA1 */
+#define DMESH_COMPACT_MIN	7		/**< Shortest compact entry: "a.b.c.d" */
 
 #define MIN_BAD_REPORT	3			/**< Don't ban before that many X-Nalt */
 #define DMESH_CALLOUT	5000		/**< Callout heartbeat every 5 seconds */
@@ -231,6 +236,7 @@ dmesh_entry_free(struct dmesh_entry *dme)
 	}
 	hash_list_free_all(&dme->bad, wfree_host_addr1);
 	WFREE(dme);
+	gnet_stats_dec_general(GNR_DMESH_ENTRIES_HELD);
 }
 
 /**
@@ -591,7 +597,9 @@ dm_alloc(const struct sha1 *sha1)
 	dm->sha1 = atom_sha1_get(sha1);
 	dm->by_host = htable_create_any(packed_host_hash_func,
 		packed_host_hash_func2, packed_host_eq_func);
-	dm->by_guid = htable_create(HASH_KEY_FIXED, GUID_RAW_SIZE);
+	dm->by_guid = NULL;		/* Created with first firewalled entry */
+
+	gnet_stats_inc_general(GNR_DMESH_SHA1_HELD);
 
 	return dm;
 }
@@ -614,10 +622,14 @@ dm_free(struct dmesh *dm)
 	htable_free_null(&dm->by_host);
 
 	/* Keys were GUID in the dmesh_entry, no need to free them */
-	htable_free_null(&dm->by_guid);
+	if (dm->by_guid != NULL) {
+		htable_free_null(&dm->by_guid);
+		gnet_stats_dec_general(GNR_DMESH_GUID_INDEXES_HELD);
+	}
 
 	atom_sha1_free_null(&dm->sha1);
 	WFREE(dm);
+	gnet_stats_dec_general(GNR_DMESH_SHA1_HELD);
 }
 
 /**
@@ -643,6 +655,7 @@ dm_remove_entry(struct dmesh *dm, struct dmesh_entry *dme)
 	}
 
 	if (dme->fw_entry) {
+		g_assert(dm->by_guid != NULL);
 		found = htable_lookup_extended(dm->by_guid,
 					dme->e.fwh.guid, &key, &value);
 	} else {
@@ -662,6 +675,10 @@ dm_remove_entry(struct dmesh *dm, struct dmesh_entry *dme)
 
 	if (dme->fw_entry) {
 		htable_remove(dm->by_guid, dme->e.fwh.guid);
+		if (0 == htable_count(dm->by_guid)) {
+			htable_free_null(&dm->by_guid);
+			gnet_stats_dec_general(GNR_DMESH_GUID_INDEXES_HELD);
+		}
 	} else {
 		htable_remove(dm->by_host, &packed);
 		wfree_packed_host(deconstify_pointer(key), NULL);
@@ -1030,6 +1047,7 @@ dmesh_raw_add(const struct sha1 *sha1, const dmesh_urlinfo_t *info,
 		 */
 
 		WALLOC(dme);
+		gnet_stats_inc_general(GNR_DMESH_ENTRIES_HELD);
 
 		dme->inserted = now;
 		dme->stamp = stamp;
@@ -1133,7 +1151,7 @@ dmesh_raw_fw_add(const struct sha1 *sha1, const dmesh_fwinfo_t *info,
 	 * See whether we knew something about this host already.
 	 */
 
-	dme = htable_lookup(dm->by_guid, info->guid);
+	dme = NULL == dm->by_guid ? NULL : htable_lookup(dm->by_guid, info->guid);
 
 	if (dme) {
 		/*
@@ -1166,6 +1184,7 @@ dmesh_raw_fw_add(const struct sha1 *sha1, const dmesh_fwinfo_t *info,
 		 */
 
 		WALLOC(dme);
+		gnet_stats_inc_general(GNR_DMESH_ENTRIES_HELD);
 
 		dme->inserted = now;
 		dme->stamp = stamp;
@@ -1190,6 +1209,11 @@ dmesh_raw_fw_add(const struct sha1 *sha1, const dmesh_fwinfo_t *info,
 		list_append(dm->entries, dme);
 		dm->last_update = now;
 
+		if (NULL == dm->by_guid) {
+			dm->by_guid = htable_create(HASH_KEY_FIXED, GUID_RAW_SIZE);
+			gnet_stats_inc_general(GNR_DMESH_GUID_INDEXES_HELD);
+		}
+
 		htable_insert(dm->by_guid, dme->e.fwh.guid, dme);
 
 		if (list_length(dm->entries) == MAX_ENTRIES) {
@@ -1446,7 +1470,7 @@ dmesh_good_fw_mark(const struct sha1 *sha1,
 	struct dmesh_entry *dme;
 
 	dm = hikset_lookup(mesh, sha1);
-	if (dm == NULL)
+	if (dm == NULL || NULL == dm->by_guid)
 		return;			/* Weird, but it doesn't matter */
 
 	dme = htable_lookup(dm->by_guid, guid);
@@ -1977,6 +2001,8 @@ dmesh_alternate_location(const struct sha1 *sha1,
 	list_iter_t *iter;
 	bool complete_file;
 	bool can_share_partials;
+	uint64 start;
+	PROF_REGION(prof_dmesh_altloc, "dmesh-alt-loc");
 
 	g_assert(sha1);
 	g_assert(buf);
@@ -1990,6 +2016,8 @@ dmesh_alternate_location(const struct sha1 *sha1,
 	if (size <= 3)		/* Account for trailing NUL + "\r\n" */
 		return 0;
 
+	start = prof_start();
+
 	/*
 	 * Shall we emit continuations?
 	 *
@@ -2215,6 +2243,12 @@ dmesh_alternate_location(const struct sha1 *sha1,
 
 	/*
 	 * Second pass.
+	 *
+	 * Compact entries do not all have the same length: an IPv6 address with
+	 * a port is much longer than a bare IPv4 address.  When an entry does not
+	 * fit, we keep trying the next ones, but stop as soon as not even the
+	 * shortest possible entry would fit: formatting the remaining ones, when
+	 * we have hundreds of candidates, would be wasted time.
 	 */
 
 	SHUFFLE_ARRAY_N(selected, nselected);
@@ -2232,6 +2266,8 @@ dmesh_alternate_location(const struct sha1 *sha1,
 
 		if (header_fmt_append_value(fmt, url))
 			added = TRUE;
+		else if (added && !header_fmt_value_fits(fmt, DMESH_COMPACT_MIN))
+			break;
 	}
 
 	if (NULL == guid)
@@ -2383,6 +2419,7 @@ nomore:
 			header_fmt_string(fmt), length);
 	}
 	header_fmt_free(&fmt);
+	prof_end(&prof_dmesh_altloc, start);
 
 	return len;
 }
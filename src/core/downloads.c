@@ -114,6 +114,7 @@
 #include "lib/iso3166.h"
 #include "lib/magnet.h"
 #include "lib/palloc.h"
+#include "lib/prof.h"
 #include "lib/parse.h"
 #include "lib/plist.h"
 #include "lib/pslist.h"
@@ -9236,8 +9237,10 @@ download_flush(struct download *d, bool *trimmed, bool may_stop)
 	entropy_harvest_small(VARLEN(d), VARLEN(old_held), VARLEN(old_pos), NULL);
 
 	do {
+		PROF_REGION(prof_flush, "disk-flush");
 		iovec_t *iov;
 		ssize_t ret;
+		uint64 start;
 		int n;
 
 		buffers_check_held(d);
@@ -9247,7 +9250,9 @@ download_flush(struct download *d, bool *trimmed, bool may_stop)
 		 */
 
 		iov = buffers_to_iovec(d, &n);
+		start = prof_start();
 		ret = file_object_pwritev(d->out_file, iov, n, d->pos);
+		prof_end(&prof_flush, start);
 		HFREE_NULL(iov);
 
 		b->mode = DL_BUF_READING;
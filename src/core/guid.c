@@ -89,6 +89,7 @@ static char db_guid_base[] = "banned_guid";
 static char db_guid_what[] = "Banned GUIDs";
 
 #define GUID_DATA_VERSION		0		/**< Serialization version number */
+#define GUID_MAP_CACHE_SIZE		1024	/**< Amount of SDBM pages to cache */
 #define GUID_PRUNE_PERIOD		(3000 * 1000)	/**< in ms */
 #define GUID_SYNC_PERIOD		(60 * 1000)		/**< 1 minute, in ms */
 #define GUID_STABLE_PROBA		0.25			/**< 25% */
@@ -852,6 +853,8 @@ guid_init(void)
 		db_guid_base, kv, packing, 1,
 		guid_hash, guid_eq, FALSE);
 
+	dbmw_set_map_cache(db_guid, GUID_MAP_CACHE_SIZE);
+
 	guid_prune_old();
 
 	guid_prune_ev = cq_periodic_main_add(
@@ -1478,9 +1478,53 @@ hcache_prune(hcache_type_t type)
     stop_mass_update(hc);
 }
 
+/**
+ * Copy hosts from the cache into `hosts', starting at index `start' and
+ * stopping when `hcount' entries are filled or the cache has been fully
+ * visited.
+ *
+ * The walk starts at the head of the list, where hcache_add() puts the
+ * hosts it records, in effect using the most recent hosts we know about.
+ * No memory is allocated.
+ *
+ * Entries already present in the vector (from another cache), as recorded
+ * in `seen', are skipped without leaving holes in the vector.
+ *
+ * @param hc		the cache to copy hosts from
+ * @param hosts		base of vector to fill
+ * @param start		index of first entry to fill
+ * @param hcount	size of host vector
+ * @param seen		if non-NULL, hosts already present in the vector
+ *
+ * @return the new amount of filled entries in the vector.
+ */
+static int
+hcache_fill_from(const hostcache_t *hc,
+	gnet_host_t *hosts, int start, int hcount, const hset_t *seen)
+{
+	const gnet_host_t *h;
+	int i = start;
+
+	for (
+		h = hash_list_head(hc->hostlist);
+		h != NULL && i < hcount;
+		h = hash_list_next(hc->hostlist, h)
+	) {
+		/*
+		 * Cannot do a struct copy, the host atom may be shorter than
+		 * the structure when holding an IPv4 address.
+		 */
+
+		if (NULL == seen || !hset_contains(seen, h))
+			gnet_host_copy(&hosts[i++], h);
+	}
+
+	return i;
+}
+
 /**
  * Fill `hosts', an array of `hcount' hosts already allocated with at most
- * `hcount' hosts from out caught list, without removing those hosts from
+ * `hcount' hosts from our caught list, without removing those hosts from
  * the list.
  *
  * @param net		network preference (for HOST_ULTRA and HOST_GUESS)
@@ -1497,9 +1541,6 @@ hcache_fill_caught_array(host_net_t net, host_type_t type,
 	int i;
 	hostcache_t *hc = NULL;
 	hostcache_t *hc2 = NULL;
-	hset_t *seen_host =
-		hset_create_any(gnet_host_hash, gnet_host_hash2, gnet_host_equal);
-	hash_list_iter_t *iter;
 
     switch (type) {
     case HOST_ANY:
@@ -1579,62 +1620,24 @@ hcache_fill_caught_array(host_net_t net, host_type_t type,
 
 	/*
 	 * We first try to fill IPv6 addresses, or IPv4 if they only want that.
+	 *
+	 * If we have an alternate cache and if we're missing entries, use
+	 * it to fill up the vector.
 	 */
 
-	iter = hash_list_iterator(hc->hostlist);
-	for (i = 0; i < hcount; i++) {
-		gnet_host_t *h;
-
-		h = hash_list_iter_next(iter);
-		if (NULL == h)
-			break;
-
-		if (hset_contains(seen_host, h))
-			continue;
-
-		/*
-		 * Cannot do a struct copy, the host atom may be shorter than
-		 * the structure when holding an IPv4 address.
-		 */
-
-		gnet_host_copy(&hosts[i], h);
-
-		hset_insert(seen_host, &hosts[i]);
-	}
-	hash_list_iter_release(&iter);
-
-	/*
-	 * If we have an alternate cache and if we're missing entries, iterate
-	 * once again to fill up the vector.
-	 */
-
-	if (NULL == hc2 || i == hcount)
-		goto done;
+	i = hcache_fill_from(hc, hosts, 0, hcount, NULL);
 
-	iter = hash_list_iterator(hc2->hostlist);
-	for (/* empty */; i < hcount; i++) {
-		gnet_host_t *h;
+	if (hc2 != NULL && i < hcount) {
+		hset_t *seen =
+			hset_create_any(gnet_host_hash, gnet_host_hash2, gnet_host_equal);
+		int j;
 
-		h = hash_list_iter_next(iter);
-		if (NULL == h)
-			break;
+		for (j = 0; j < i; j++)
+			hset_insert(seen, &hosts[j]);
 
-		if (hset_contains(seen_host, h))
-			continue;
-
-		/*
-		 * Cannot do a struct copy, the host atom may be shorter than
-		 * the structure when holding an IPv4 address.
-		 */
-
-		gnet_host_copy(&hosts[i], h);
-
-		hset_insert(seen_host, &hosts[i]);
+		i = hcache_fill_from(hc2, hosts, i, hcount, seen);
+		hset_free_null(&seen);	/* Keys point into vector */
 	}
-	hash_list_iter_release(&iter);
-
-done:
-	hset_free_null(&seen_host);	/* Keys point into vector */
 
 	return i;				/* Amount of hosts we filled */
 }
@@ -122,6 +122,7 @@ static char db_spam_what[] = "Spamming hosts";
 
 #define SPAM_MAX_PORTS			5		/**< Max amount of ports tracked */
 #define SPAM_DB_CACHE_SIZE		512		/**< Amount of keys to keep in cache */
+#define SPAM_MAP_CACHE_SIZE		1024	/**< Amount of SDBM pages to cache */
 #define SPAM_DATA_VERSION		0		/**< Serialization version number */
 #define SPAM_PRUNE_PERIOD		(3000 * 1000)	/**< in ms */
 #define SPAM_SYNC_PERIOD		(60 * 1000)		/**< 1 minute, in ms */
@@ -1160,6 +1161,8 @@ hostiles_init(void)
 		db_spam_base, kv, packing, SPAM_DB_CACHE_SIZE,
 		gnet_host_hash, gnet_host_equal, FALSE);
 
+	dbmw_set_map_cache(db_spam, SPAM_MAP_CACHE_SIZE);
+
 	hostiles_spam_prune_old();
 
 	hostiles_spam_prune_ev = cq_periodic_main_add(
@@ -177,7 +177,7 @@ enum parq_ul_queue_magic {
  */
 struct parq_ul_queue {
 	enum parq_ul_queue_magic magic;
-	plist_t *by_position;		/**< Queued items sorted on position. Newest is
+	hash_list_t *by_position;	/**< Queued items sorted on position. Newest is
 								 added to the end. */
 	hash_list_t *by_rel_pos;	/**< Queued items sorted by relative position */
 	hash_list_t *by_date_dead;	/**< Dead items sorted on last update */
@@ -189,7 +189,9 @@ struct parq_ul_queue {
 	int active_queued_cnt;	/**< Number of actively queued entries */
 	int alive;				/**< Amount of alive entries */
 	int frozen;				/**< Subset of alive entries that are frozen */
+	time_t next_scan;		/**< Earliest time an alive entry needs a look */
 	unsigned recompute:1;	/**< Flagged as requiring update of internal data */
+	unsigned reposition:1;	/**< Absolute positions need to be renumbered */
 	unsigned active:1;		/**< Set to false when the number of upload slots
 								 was decreased but the queue still contained
 								 queued items. This queue shall be removed when
@@ -1442,14 +1444,18 @@ parq_upload_update_eta(struct parq_ul_queue *which_ul_queue)
 		 * Locate the first active upload in this queue.
 		 */
 
-		PLIST_FOREACH(which_ul_queue->by_position, l) {
-			struct parq_ul_queued *puq = l->data;
+		iter = hash_list_iterator(which_ul_queue->by_position);
+
+		while (hash_list_iter_has_next(iter)) {
+			struct parq_ul_queued *puq = hash_list_iter_next(iter);
 
 			if (puq->has_slot) {		/* Recompute ETA */
 				eta += parq_estimated_slot_time(puq);
 				break;
 			}
 		}
+
+		hash_list_iter_release(&iter);
 	}
 
 	if (eta == 0 && GNET_PROPERTY(ul_running) > GNET_PROPERTY(max_uploads)) {
@@ -1508,38 +1514,39 @@ parq_upload_update_eta(struct parq_ul_queue *which_ul_queue)
 }
 
 /**
- * Decreases the position of all queued items after the given queued item.
+ * Compute the earliest time at which parq_upload_queue_timer() could have
+ * to act on the queued entry: either to register a QUEUE callback once the
+ * entry expired, or to declare it dead once its grace period is over.
+ *
+ * This is a lower bound: the real action can be further delayed by the
+ * state of the entry (pending QUEUE, banning) but never happen sooner.
  */
-static void
-parq_upload_decrease_all_after(struct parq_ul_queued *puq)
+static time_t
+parq_upload_deadline(const struct parq_ul_queued *puq)
 {
-	plist_t *l;
-	int pos_cnt = 0;	/* Used for assertion */
+	time_t queue_time, dead_time;
 
-	g_assert(puq != NULL);
-	g_assert(puq->queue != NULL);
-	g_assert(puq->queue->by_position != NULL);
-	g_assert(puq->queue->by_position_length > 0);
+	queue_time = MAX(puq->expire, time_advance(puq->send_next_queue, 1));
+	dead_time = time_advance(puq->expire, PARQ_GRACE_TIME + 1);
 
-	l = plist_find(puq->queue->by_position, puq);
-	pos_cnt = ((struct parq_ul_queued *) l->data)->position;
+	return MIN(queue_time, dead_time);
+}
 
-	l = plist_next(l);	/* Decrease _after_ current parq */
+/**
+ * Make sure the queue timer will not skip the entry when its deadline
+ * comes, after its expiration or QUEUE sending time was changed.
+ */
+static void
+parq_upload_timer_wakeup(const struct parq_ul_queued *puq)
+{
+	time_t deadline;
 
-	/*
-	 * Cycle through list and decrease all positions by one. Position should
-	 * never reach 0 which would mean the queued item is currently uploading
-	 */
-	for (;	l; l = plist_next(l)) {
-		struct parq_ul_queued *p = l->data;
+	parq_ul_queued_check(puq);
 
-		g_assert(p != NULL);
-		g_assert(p->position > 1);
-		g_assert(p->position - 1 == UNSIGNED(pos_cnt));
+	deadline = parq_upload_deadline(puq);
 
-		p->position--;
-		pos_cnt++;
-	}
+	if (delta_time(deadline, puq->queue->next_scan) < 0)
+		puq->queue->next_scan = deadline;
 }
 
 /**
@@ -1566,6 +1573,7 @@ parq_upload_insert_relative(struct parq_ul_queued *puq)
 
 	puq->relative_position = 0;
 	hash_list_insert_sorted(puq->queue->by_rel_pos, puq, parq_ul_rel_pos_cmp);
+	parq_upload_timer_wakeup(puq);
 }
 
 /**
@@ -1590,12 +1598,14 @@ parq_upload_recompute_positions(struct parq_ul_queue *q)
 {
 	uint pos = 0;
 	uint prev_pos = 0;
-	plist_t *l;
+	hash_list_iter_t *iter;
 
 	parq_ul_queue_check(q);
 
-	PLIST_FOREACH(q->by_position, l) {
-		struct parq_ul_queued *puq = l->data;
+	iter = hash_list_iterator(q->by_position);
+
+	while (hash_list_iter_has_next(iter)) {
+		struct parq_ul_queued *puq = hash_list_iter_next(iter);
 
 		parq_ul_queued_check(puq);
 		g_assert(puq->queue == q);
@@ -1606,7 +1616,10 @@ parq_upload_recompute_positions(struct parq_ul_queue *q)
 		puq->position = ++pos;
 	}
 
+	hash_list_iter_release(&iter);
+
 	g_assert(pos <= UNSIGNED(q->by_position_length));
+	q->reposition = FALSE;
 }
 
 /**
@@ -1700,8 +1713,6 @@ parq_upload_free(struct parq_ul_queued *puq)
 	if (puq->u != NULL)
 		puq->u->parq_ul = NULL;
 
-	parq_upload_decrease_all_after(puq);
-
 	if (puq->flags & PARQ_UL_QUEUE)
 		hash_list_remove(ul_parq_queue, puq);
 
@@ -1733,7 +1744,7 @@ parq_upload_free(struct parq_ul_queued *puq)
 	}
 
 	/* Remove the current queued item from all lists */
-	puq->queue->by_position = plist_remove(puq->queue->by_position, puq);
+	hash_list_remove(puq->queue->by_position, puq);
 
 	parq_upload_remove_relative(puq);
 
@@ -1754,12 +1765,20 @@ parq_upload_free(struct parq_ul_queued *puq)
 	 * Don't update ETA on shutdown, we don't need this information, so speed
 	 * up the shutdown process. Also it is better not doing so as on shutdown
 	 * not all entries are removed the 'correct' way, we just want to free
-	 * the memory
+	 * the memory.
+	 *
+	 * When the queue is already flagged for recomputation, the caller is
+	 * removing entries in a batch and will renumber everything once at the
+	 * end, so we just record that absolute positions are now stale.
 	 */
 	if (!parq_shutdown) {
-		parq_upload_recompute_positions(puq->queue);
-		parq_upload_recompute_relative_positions(puq->queue);
-		parq_upload_update_eta(puq->queue);
+		if (puq->queue->recompute) {
+			puq->queue->reposition = TRUE;
+		} else {
+			parq_upload_recompute_positions(puq->queue);
+			parq_upload_recompute_relative_positions(puq->queue);
+			parq_upload_update_eta(puq->queue);
+		}
 	}
 
 	/* Free the memory used by the current queued item */
@@ -1823,6 +1842,7 @@ parq_upload_new_queue(void)
 	queue->magic = PARQ_UL_QUEUE_MAGIC;
 	queue->active = TRUE;
 	queue->slot_stats = statx_make();
+	queue->by_position = hash_list_new(NULL, NULL);
 	queue->by_rel_pos = hash_list_new(NULL, NULL);
 	queue->by_date_dead = hash_list_new(NULL, NULL);
 
@@ -2004,9 +2024,10 @@ parq_upload_create(struct upload *u)
 	htable_insert(ul_all_parq_by_id, &puq->id, puq);
 
 	q->by_position_length++;
-	q->by_position = plist_append(q->by_position, puq);
+	hash_list_append(q->by_position, puq);
 
 	hash_list_append(puq->queue->by_rel_pos, puq);
+	parq_upload_timer_wakeup(puq);
 
 	if (GNET_PROPERTY(parq_debug) > 3) {
 		g_debug("PARQ UL Q %d/%zd (%3d[%3d]/%3d): New: %s \"%s\"; ID=\"%s\"",
@@ -2046,7 +2067,7 @@ parq_upload_create(struct upload *u)
 	g_assert(puq->queue != NULL);
 	g_assert(puq->queue->by_position != NULL);
 	g_assert(puq->queue->by_rel_pos != NULL);
-	g_assert(puq->queue->by_position->data != NULL);
+	g_assert(hash_list_contains(puq->queue->by_position, puq));
 	g_assert(puq->relative_position > 0);
 	g_assert(puq->relative_position <=
 		UNSIGNED(puq->queue->by_position_length));
@@ -2097,6 +2118,7 @@ parq_upload_free_queue(struct parq_ul_queue *queue)
 	ul_parqs_cnt--;
 
 	/* Free memory */
+	hash_list_free(&queue->by_position);
 	hash_list_free(&queue->by_rel_pos);
 	hash_list_free(&queue->by_date_dead);
 	statx_free(queue->slot_stats);
@@ -2299,6 +2321,7 @@ parq_upload_send_queue(struct parq_ul_queued *puq)
 	puq->queue_sent++;
 	puq->send_next_queue = parq_upload_next_queue(now, puq);
 	puq->by_addr->last_queue_sent = now;
+	parq_upload_timer_wakeup(puq);
 
 	if (GNET_PROPERTY(parq_debug)) {
 		g_debug("PARQ UL Q %d/%d (%3d[%3d]/%3d): "
@@ -2507,6 +2530,10 @@ parq_dead_timer(void *unused_udata)
 /**
  * Periodic scanning of the alive queued entries.
  *
+ * The scan is skipped entirely until the earliest deadline of the alive
+ * entries, as computed during the previous scan and lowered each time an
+ * entry is (re)inserted or has its timings changed.
+ *
  * @param now		current time
  * @param q			the queue to scan
  * @param rlp		holds pointer to the single list of items to remove
@@ -2516,12 +2543,17 @@ parq_upload_queue_timer(time_t now, struct parq_ul_queue *q, pslist_t **rlp)
 {
 	hash_list_iter_t *iter;
 	pslist_t *to_remove = *rlp;
+	time_t next_scan = TIME_T_MAX;
+
+	if (delta_time(q->next_scan, now) > 0)
+		return;
 
 	iter = hash_list_iterator(q->by_rel_pos);
 
 	while (hash_list_iter_has_next(iter)) {
 		struct parq_ul_queued *puq = hash_list_iter_next(iter);
 		time_delta_t grace;
+		time_t deadline;
 
 		g_assert(puq != NULL);
 
@@ -2581,11 +2613,23 @@ parq_upload_queue_timer(time_t now, struct parq_ul_queue *q, pslist_t **rlp)
 			 * fastest function)
 			 */
 			to_remove = pslist_prepend(to_remove, puq);
+			continue;
 		}
+
+		/*
+		 * Entries whose deadline is already reached but which we could not
+		 * process yet (pending QUEUE, slot granted, banned) will bring the
+		 * next scan back to the next timer tick.
+		 */
+
+		deadline = parq_upload_deadline(puq);
+		if (delta_time(deadline, next_scan) < 0)
+			next_scan = deadline;
 	}
 
 	hash_list_iter_release(&iter);
 
+	q->next_scan = next_scan;
 	*rlp = to_remove;
 }
 
@@ -2758,6 +2802,8 @@ parq_upload_timer(time_t now)
 		struct parq_ul_queue *q = queues->data;
 
 		if (q->recompute) {
+			if (q->reposition)
+				parq_upload_recompute_positions(q);
 			parq_upload_recompute_relative_positions(q);
 			parq_upload_update_eta(q);
 			q->recompute = FALSE;
@@ -3725,6 +3771,7 @@ parq_upload_request(struct upload *u)
 	g_assert(delta_time(puq->retry, now) >= 0);
 
 	puq->expire = time_advance(puq->retry, MIN_LIFE_TIME + PARQ_RETRY_SAFETY);
+	parq_upload_timer_wakeup(puq);
 
 	if (GNET_PROPERTY(parq_debug) > 1)
 		g_debug("[PARQ UL] %srequest for \"%s\" from %s <%s>: %s, "
@@ -4286,6 +4333,7 @@ parq_upload_remove(struct upload *u, bool was_sending, bool was_running)
 		if (0 == puq->relative_position) {
 			puq->queue->active_uploads--;
 			puq->expire = time_advance(now, GUARDING_TIME);
+			parq_upload_timer_wakeup(puq);
 
 			/*
 			 *
@@ -4374,6 +4422,7 @@ parq_upload_remove(struct upload *u, bool was_sending, bool was_running)
 		 * immediatly
 		 */
 		puq->expire = time_advance(now, GUARDING_TIME);
+		parq_upload_timer_wakeup(puq);
 	}
 
 done:
@@ -4980,7 +5029,7 @@ parq_upload_save_queue(void)
 	) {
 		struct parq_ul_queue *queue = queues->data;
 
-		PLIST_FOREACH_CALL_DATA(queue->by_position, parq_store, f);
+		hash_list_foreach(queue->by_position, parq_store, f);
 	}
 
 	file_config_close(f, &fp);
@@ -5383,6 +5432,7 @@ parq_upload_load_queue(void)
 			puq->queue_sent = entry.queue_sent;
 			puq->send_next_queue =
 				parq_upload_next_queue(entry.last_queue_sent, puq);
+			parq_upload_timer_wakeup(puq);
 
 			/* During parq_upload_create already created an ID for us */
 			htable_remove(ul_all_parq_by_id, &puq->id);
@@ -5523,18 +5573,20 @@ parq_close_pre(void)
 	 */
 	for (queues = ul_parqs; queues != NULL; queues = queues->next) {
 		struct parq_ul_queue *queue = queues->data;
+		hash_list_iter_t *iter;
 
-		PLIST_FOREACH(queue->by_position, dl) {
-			struct parq_ul_queued *puq = dl->data;
+		iter = hash_list_iterator(queue->by_position);
 
-			if (puq == NULL)
-				break;
+		while (hash_list_iter_has_next(iter)) {
+			struct parq_ul_queued *puq = hash_list_iter_next(iter);
 
 			puq->by_addr->uploading = 0;
 
 			to_remove = pslist_prepend(to_remove, puq);
 		}
 
+		hash_list_iter_release(&iter);
+
 		to_removeq = pslist_prepend(to_removeq, queue);
 	}
 
@@ -70,6 +70,7 @@
 #include "lib/htable.h"
 #include "lib/mutex.h"
 #include "lib/pow2.h"
+#include "lib/prof.h"
 #include "lib/pslist.h"
 #include "lib/random.h"
 #include "lib/sha1.h"
@@ -1500,12 +1501,11 @@ for (b = 0, i = 0; b < bytes; b++) {				\
  * Merge next leaf QRT table if node is still there.
  */
 static bgret_t
-mrg_step_merge_one(struct bgtask *unused_h, void *u, int ticks)
+mrg_step_merge_one(struct bgtask *h, void *u, int ticks)
 {
 	struct merge_context *ctx = u;
 	int ticks_used = 0;
 
-	(void) unused_h;
 	g_assert(MERGE_MAGIC == ctx->magic);
 
 	/*
@@ -1532,6 +1532,16 @@ mrg_step_merge_one(struct bgtask *unused_h, void *u, int ticks)
 		}
 
 		qrt_unref(rt);
+
+		/*
+		 * Leaf tables can have widely different sizes, hence the cost of
+		 * a tick varies: stop as soon as we exhausted our time budget.
+		 */
+
+		if (ticks_used != 0 && bg_task_over_budget(h)) {
+			bg_task_ticks_used(h, ticks_used);
+			break;
+		}
 	}
 
 	return (ctx->tables == NULL) ? BGR_NEXT : BGR_MORE;
@@ -4349,6 +4359,12 @@ qrt_apply_reversed_patch1(struct qrt_receive *qrcv, const uchar *data, int len,
  * name will be qrp_can_route_21.
  *
  * This routine is called when there are no URNs in the query, only words.
+ *
+ * To follow LimeWire's behaviour, we require only 2/3 of matching when there
+ * are at least 3 words, all of them otherwise.  Both conditions amount to
+ * tolerating at most count/3 missing words, which lets us stop probing the
+ * table as soon as that budget is exceeded: most leaves will not match, and
+ * this routine is called for each of them on every query we route.
  */
 #define CAN_ROUTE(bits)													\
 static bool G_HOT														\
@@ -4358,21 +4374,17 @@ qrp_can_route_##bits(const query_hashvec_t *qhv,						\
 	const struct query_hash * const vec = qhv->vec;						\
 	const uint8 * const arena = rt->arena;								\
 	uint8 i = qhv->count;												\
-	uint8 hit = 0, word = qhv->count;									\
+	uint8 miss = 0, allowed = qhv->count / 3;							\
 																		\
 	while (i-- > 0) {													\
 		uint32 idx = vec[i].hashcode >> (32 - bits);					\
-		/*																\
-		 * We hardwire RT_SLOT_READ here.								\
-		 * To follow LimeWire's behaviour, require only 2/3 of matching	\
-		 * when there are at least 3 words.								\
-		 *		--RAM, 2014-01-03										\
-		 */																\
-		if (0 != (0x80U & (arena[idx >> 3] << (idx & 0x7)))) {			\
-			hit++;														\
+		/* We hardwire RT_SLOT_READ here. */							\
+		if (0 == (0x80U & (arena[idx >> 3] << (idx & 0x7)))) {			\
+			if (++miss > allowed)										\
+				return FALSE;											\
 		}																\
 	}																	\
-	return word < 3 ? hit == word : 3 * hit / word >= 2;				\
+	return TRUE;														\
 }
 
 /* Create eight QRT lookup routines with fixed shift factors. */
@@ -5429,10 +5441,12 @@ qrt_build_query_target(
 	query_hashvec_t *qhvec, int hops, int ttl, bool leaves,
 	gnutella_node_t *source)
 {
+	PROF_REGION(prof_qrp, "qrp-query-target");
 	pslist_t *nodes = NULL;		/* Targets for the query */
 	const pslist_t *sl;
 	bool sha1_query;
 	bool whats_new;
+	uint64 start;
 
 	g_assert(qhvec != NULL);
 	g_assert(hops >= 0);
@@ -5455,6 +5469,7 @@ qrt_build_query_target(
 		return NULL;
 	}
 
+	start = prof_start();
 	sha1_query = qhvec_has_urn(qhvec);
 
 	/*
@@ -5606,6 +5621,8 @@ qrt_build_query_target(
 			node_inc_qrp_match(dn);
 	}
 
+	prof_end(&prof_qrp, start);
+
 	return nodes;
 }
 
@@ -56,6 +56,7 @@
 #include "lib/host_addr.h"
 #include "lib/hset.h"
 #include "lib/htable.h"
+#include "lib/prof.h"
 #include "lib/pslist.h"
 #include "lib/str.h"
 #include "lib/stringify.h"
@@ -97,6 +98,25 @@ routing_udp_node_check(const struct routing_udp_node * const un)
 
 #define ROUTE_UDP_LIFETIME	180		/**< Keep UDP routes for 3 minutes */
 
+/**
+ * A route recorded for a message beyond the inline ones: the node from which
+ * we got it and, for broadcasted messages, the highest TTL seen along that
+ * route.
+ */
+struct route_hop {
+	struct route_data *rd;		/**< route_data from where the message came */
+	uint8 ttl;					/**< For broadcasted messages: TTL seen */
+};
+
+/**
+ * Amount of routes stored directly within the message entry.
+ *
+ * The vast majority of messages are only seen from one or two nodes, so
+ * keeping these routes inline avoids any extra allocation and the pointer
+ * chasing through lists when looking up or purging routes.
+ */
+#define ROUTE_INLINE		2
+
 /**
  * An entry in the routing table.
  *
@@ -107,17 +127,81 @@ routing_udp_node_check(const struct routing_udp_node * const un)
  * Query hit routes and push routes are precious, therefore they are
  * moved to the tail of the "message_array[]" when they get used to increase
  * their liftime.
+ *
+ * The first ROUTE_INLINE routes are held in "hops[]", with their TTL in
+ * "hop_ttl[]": the TTLs are kept apart so that they fit in the padding at the
+ * end of the structure instead of padding each inline route to 16 bytes.
+ * On 64-bit machines the entry is therefore 64 bytes, where it used to be
+ * 48 bytes plus two 16-byte list cells per route.
+ *
+ * The remaining routes are in the "extra" array, whose allocated length is
+ * "extra_len".  Since the entry can be moved around in memory, we cannot
+ * keep a pointer to the inline arrays: routes must be accessed through
+ * message_route_rd() and message_route_ttl().
  */
 struct message {
 	struct guid muid;			/**< Message UID */
 	struct message **slot;		/**< Place where we're referenced from */
-	pslist_t *routes;            /**< route_data from where the message came */
-	pslist_t *ttls;			/**< For broadcasted messages: TTL by route */
+	struct route_data *hops[ROUTE_INLINE];	/**< First routes, inline */
+	struct route_hop *extra;	/**< Additional routes, NULL if none */
+	uint16 routes;				/**< Amount of recorded routes */
+	uint16 extra_len;			/**< Allocated length of the "extra" array */
 	uint8 function;				/**< Type of the message */
 	uint8 ttl;					/**< Max TTL we saw for this message */
 	uint8 chunk_idx;			/**< Index of chunk holding the slot */
+	uint8 hop_ttl[ROUTE_INLINE];	/**< TTL seen along the inline routes */
 };
 
+/**
+ * @return the route_data of the i-th route recorded for the message.
+ */
+static inline struct route_data *
+message_route_rd(const struct message *m, unsigned i)
+{
+	g_assert(i < m->routes);
+
+	return i < ROUTE_INLINE ? m->hops[i] : m->extra[i - ROUTE_INLINE].rd;
+}
+
+/**
+ * @return pointer to the TTL seen along the i-th route of the message.
+ */
+static inline uint8 *
+message_route_ttl(struct message *m, unsigned i)
+{
+	g_assert(i < m->routes);
+
+	return i < ROUTE_INLINE ?
+		&m->hop_ttl[i] : &m->extra[i - ROUTE_INLINE].ttl;
+}
+
+/**
+ * Set the i-th route of the message.
+ */
+static inline void
+message_route_set(struct message *m, unsigned i,
+	struct route_data *rd, uint8 ttl)
+{
+	g_assert(i < m->routes);
+
+	if (i < ROUTE_INLINE) {
+		m->hops[i] = rd;
+		m->hop_ttl[i] = ttl;
+	} else {
+		m->extra[i - ROUTE_INLINE].rd = rd;
+		m->extra[i - ROUTE_INLINE].ttl = ttl;
+	}
+}
+
+/**
+ * Copy the i-th route of the message over the j-th one.
+ */
+static inline void
+message_route_copy(struct message *m, unsigned j, unsigned i)
+{
+	message_route_set(m, j, message_route_rd(m, i), *message_route_ttl(m, i));
+}
+
 /**
  * We don't store a list of nodes in the message structure, but a list of
  * route_data: the reason is that nodes can go away, but we don't want to
@@ -247,6 +331,7 @@ static aging_table_t *at_udp_routes;
 static bool find_message(
 	const struct guid *muid, uint8 function, struct message **m);
 static void free_route_list(struct message *m);
+static int message_route_find(struct message *m, const struct route_data *rd);
 
 static inline bool
 is_banned_push(const struct guid *guid)
@@ -898,11 +983,11 @@ clean_entry(struct message *entry)
 
 	hset_remove(routing.messages_hashed, entry);
 
-	if (entry->routes != NULL)
+	if (entry->routes != 0)
 		free_route_list(entry);
 
-	g_assert(entry->ttls == NULL);		/* Cleaned by free_route_list() */
-	g_assert(entry->routes == NULL);	/* Idem */
+	g_assert(0 == entry->routes);		/* Cleaned by free_route_list() */
+	g_assert(NULL == entry->extra);		/* Idem */
 
 	entry->ttl = 0;
 }
@@ -1346,7 +1431,6 @@ static bool
 route_node_sent_message(gnutella_node_t *n, struct message *m)
 {
 	struct route_data *route;
-	pslist_t *sl;
 
 	if (n == fake_node)
 		route = &fake_route;
@@ -1361,12 +1445,7 @@ route_node_sent_message(gnutella_node_t *n, struct message *m)
 	if (route == NULL)
 		return FALSE;
 
-	PSLIST_FOREACH(m->routes, sl) {
-		if (route == sl->data)
-			return TRUE;
-	}
-
-	return FALSE;
+	return message_route_find(m, route) >= 0;
 }
 
 /**
@@ -1380,9 +1459,9 @@ route_node_sent_message(gnutella_node_t *n, struct message *m)
 static bool
 route_node_ttl_higher(gnutella_node_t *n, struct message *m, uint8 ttl)
 {
-	pslist_t *l;
 	int i;
 	struct route_data *route;
+	uint8 *hop_ttl;
 
 	g_assert(n != fake_node);
 
@@ -1397,7 +1476,7 @@ route_node_ttl_higher(gnutella_node_t *n, struct message *m, uint8 ttl)
 	if (GTA_MSG_G2_SEARCH == m->function)
 		return FALSE;		/* As a G2 leaf, we do not care, it's a dup */
 
-	g_assert(m->ttls != NULL);
+	g_assert(m->routes != 0);
 	g_assert(
 		m->function == GTA_MSG_PUSH_REQUEST || m->function == GTA_MSG_SEARCH);
 
@@ -1405,23 +1484,20 @@ route_node_ttl_higher(gnutella_node_t *n, struct message *m, uint8 ttl)
 
 	g_assert(route != NULL);
 
-	for (l = m->routes, i = 0; l; l = pslist_next(l), i++) {
-		if (route == l->data) {
-			pslist_t *t = pslist_nth(m->ttls, i);
-			uint8 old_ttl;
-
-			g_assert(t != NULL);
-			old_ttl = GPOINTER_TO_INT(t->data);
-			if (old_ttl >= ttl)
-				return FALSE;
+	i = message_route_find(m, route);
 
-			t->data = GUINT_TO_POINTER((uint) ttl);
-			return TRUE;
-		}
+	if (i < 0) {
+		g_error("route not found -- message was supposed to be a duplicate");
+		return FALSE;
 	}
 
-	g_error("route not found -- message was supposed to be a duplicate");
-	return FALSE;
+	hop_ttl = message_route_ttl(m, i);
+
+	if (*hop_ttl >= ttl)
+		return FALSE;
+
+	*hop_ttl = ttl;
+	return TRUE;
 }
 
 /**
@@ -1634,22 +1710,87 @@ remove_one_message_reference(struct route_data *rd)
 static void
 free_route_list(struct message *m)
 {
-	pslist_t *sl;
+	unsigned i;
 
 	g_assert(m);
 
-	PSLIST_FOREACH(m->routes, sl) {
-		remove_one_message_reference(sl->data);
+	for (i = 0; i < m->routes; i++) {
+		remove_one_message_reference(message_route_rd(m, i));
 	}
 
-	pslist_free_null(&m->routes);
+	WFREE_ARRAY_NULL(m->extra, m->extra_len);
+	m->extra_len = 0;
+	m->routes = 0;
+}
 
-	/*
-	 * If the message was a broadcasted one, we kept track of the TTL of
-	 * each message along the route.  This needs to be freed as well.
-	 */
+/**
+ * Look for the route_data in the routes recorded for the message.
+ *
+ * @return the index of the route, -1 if not found.
+ */
+static int
+message_route_find(struct message *m, const struct route_data *rd)
+{
+	unsigned i;
+
+	for (i = 0; i < m->routes; i++) {
+		if (rd == message_route_rd(m, i))
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Record a new route for the message, along with the TTL of the message
+ * as seen from that route.
+ *
+ * The caller is responsible for accounting the new message reference in
+ * the route_data.
+ */
+static void
+message_route_append(struct message *m, struct route_data *rd, uint8 ttl)
+{
+	g_assert(m->routes < MAX_INT_VAL(uint16));
+
+	if (m->routes >= ROUTE_INLINE) {
+		unsigned n = m->routes - ROUTE_INLINE;
+
+		if (n >= m->extra_len) {
+			unsigned len = MAX(ROUTE_INLINE, 2 * m->extra_len);
+
+			len = MIN(len, MAX_INT_VAL(uint16));
+			WREALLOC_ARRAY(m->extra, m->extra_len, len);
+			m->extra_len = len;
+		}
+	}
+
+	m->routes++;
+	message_route_set(m, m->routes - 1, rd, ttl);
+}
+
+/**
+ * Remove the i-th route from the message, preserving the order of the
+ * remaining ones.
+ *
+ * The caller is responsible for removing the message reference from the
+ * route_data.
+ */
+static void
+message_route_remove(struct message *m, unsigned i)
+{
+	g_assert(i < m->routes);
 
-	pslist_free_null(&m->ttls);	/* Data are ints, nothing to free */
+	for (i++; i < m->routes; i++) {
+		message_route_copy(m, i - 1, i);
+	}
+
+	m->routes--;
+
+	if (m->routes <= ROUTE_INLINE && m->extra != NULL) {
+		WFREE_ARRAY_NULL(m->extra, m->extra_len);
+		m->extra_len = 0;
+	}
 }
 
 /**
@@ -1746,7 +1887,7 @@ message_add(const struct guid *muid, uint8 function,
 		entry = m;		/* Reuse existing entry */
 	else {
 		entry = get_next_entry();
-		g_assert(entry->routes == NULL);
+		g_assert(0 == entry->routes);
 
 		/* fill in that storage space */
 		entry->muid = *muid;
@@ -1763,14 +1904,11 @@ message_add(const struct guid *muid, uint8 function,
 	 */
 
 	if (!found || !route_node_sent_message(node, m)) {
-		uint ttl;
-
-		route->saved_messages++;
-		entry->routes = pslist_append(entry->routes, route);
+		uint8 ttl;
 
 		/*
-		 * If message is typically broadcasted, also record the TTL of
-		 * that route, since a node is allowed to resend us a message
+		 * Record the TTL of that route along with it: if message is
+		 * typically broadcasted, a node is allowed to resend us a message
 		 * if it comes with a higher TTL than previously seen.
 		 *		--RAM, 2005-10-02
 		 */
@@ -1779,12 +1917,8 @@ message_add(const struct guid *muid, uint8 function,
 				? GNET_PROPERTY(my_ttl)
 				: gnutella_header_get_ttl(&node->header);
 
-		switch (function) {
-		case GTA_MSG_PUSH_REQUEST:
-		case GTA_MSG_SEARCH:
-			entry->ttls = pslist_append(entry->ttls, GUINT_TO_POINTER(ttl));
-			break;
-		}
+		route->saved_messages++;
+		message_route_append(entry, route, ttl);
 	}
 
 	if (found)
@@ -1810,31 +1944,30 @@ message_add(const struct guid *muid, uint8 function,
 static void
 purge_dangling_references(struct message *m)
 {
-	pslist_t *sl;
-	pslist_t *t;
+	unsigned i, j;
+
+	/*
+	 * Compact the surviving routes in place, in a single pass.
+	 */
 
-	for (sl = m->routes, t = m->ttls; sl; /* empty */) {
-		struct route_data *rd = sl->data;
+	for (i = j = 0; i < m->routes; i++) {
+		struct route_data *rd = message_route_rd(m, i);
 
-		if (rd->node == NULL) {
-			pslist_t *next = pslist_next(sl);
-			m->routes = pslist_remove_link(m->routes, sl);
+		if (NULL == rd->node) {
 			remove_one_message_reference(rd);
-			pslist_free_1(sl);
-			sl = next;
-
-			if (t) {
-				next = pslist_next(t);
-				m->ttls = pslist_remove_link(m->ttls, t);
-				pslist_free_1(t);
-				t = next;
-			}
 		} else {
-			sl = pslist_next(sl);
-			if (t)
-				t = pslist_next(t);
+			if (i != j)
+				message_route_copy(m, j, i);
+			j++;
 		}
 	}
+
+	m->routes = j;
+
+	if (m->routes <= ROUTE_INLINE && m->extra != NULL) {
+		WFREE_ARRAY_NULL(m->extra, m->extra_len);
+		m->extra_len = 0;
+	}
 }
 
 /**
@@ -1849,9 +1982,8 @@ message_forget(const struct guid *muid, uint8 function, gnutella_node_t *node)
 {
 	bool found;
 	struct message *m;
-	pslist_t *sl;
-	pslist_t *t;
 	struct route_data *route;
+	int i;
 
 	g_assert(muid != NULL);
 	node_check(node);
@@ -1863,20 +1995,11 @@ message_forget(const struct guid *muid, uint8 function, gnutella_node_t *node)
 	route = get_routing_data(node);
 	g_return_unless(route != NULL);
 
-	for (
-		sl = m->routes, t = m->ttls;
-		sl != NULL;
-		sl = pslist_next(sl), t = pslist_next(t)
-	) {
-		struct route_data *rd = sl->data;
+	i = message_route_find(m, route);
 
-		if (route == rd) {
-			m->routes = pslist_remove_link(m->routes, sl);
-			if (t != NULL)
-				m->ttls = pslist_remove_link(m->ttls, t);
-			remove_one_message_reference(rd);
-			break;
-		}
+	if (i >= 0) {
+		message_route_remove(m, i);
+		remove_one_message_reference(route);
 	}
 }
 
@@ -1884,7 +2007,7 @@ message_forget(const struct guid *muid, uint8 function, gnutella_node_t *node)
  * Look for a particular message in the routing tables.
  *
  * If none of the nodes that sent us the message are still present, then
- * m->routes will be NULL.
+ * m->routes will be 0.
  *
  * @return TRUE if the message is found.
  */
@@ -2021,7 +2144,7 @@ static bool
 forward_message(
 	struct route_log *route_log,
 	gnutella_node_t **node,
-	gnutella_node_t *target, struct route_dest *dest, pslist_t *routes)
+	gnutella_node_t *target, struct route_dest *dest, struct message *routes)
 {
 	gnutella_node_t *sender = *node;
 
@@ -2081,15 +2204,15 @@ forward_message(
 		 */
 
 		if (routes != NULL) {
-			pslist_t *l;
 			pslist_t *nodes = NULL;
 			int count = 0;
+			unsigned i;
 
 			g_assert(gnutella_header_get_function(&sender->header)
 					== GTA_MSG_PUSH_REQUEST);
 
-			PSLIST_FOREACH(routes, l) {
-				struct route_data *rd = l->data;
+			for (i = 0; i < routes->routes; i++) {
+				struct route_data *rd = message_route_rd(routes, i);
 				if (rd->node == sender)
 					continue;
 
@@ -2299,7 +2422,7 @@ handle_duplicate(struct route_log *route_log, gnutella_node_t **node,
 				gmsg_log_bad(sender, "dup message from same node");
 		}
 	} else {
-		if (m->routes == NULL) {
+		if (0 == m->routes) {
 			routing_log_extra(route_log, "all routes lost");
 
 			if (GNET_PROPERTY(log_dup_gnutella_other_node)) {
@@ -2309,13 +2432,13 @@ handle_duplicate(struct route_log *route_log, gnutella_node_t **node,
 			}
 		} else {
 			if (GNET_PROPERTY(log_gnutella_routing)) {
-				unsigned count = pslist_length(m->routes);
+				unsigned count = m->routes;
 				routing_log_extra(route_log, "%u remaining route%s",
 					count, plural(count));
 			}
 
 			if (GNET_PROPERTY(log_dup_gnutella_other_node)) {
-				unsigned count = pslist_length(m->routes);
+				unsigned count = m->routes;
 				gmsg_log_duplicate(sender,
 					"from %s: %sother node, %u route%s (dups=%u)",
 					node_infostr(sender), oob ? "OOB, " : "",
@@ -2490,10 +2613,10 @@ route_push(struct route_log *route_log,
 		 */
 
 		revitalize_entry(m, FALSE);
-		forward_message(route_log, node, NULL, dest, m->routes);
+		forward_message(route_log, node, NULL, dest, m);
 
 	} else {
-		if (m && m->routes == NULL) {
+		if (m && 0 == m->routes) {
 			routing_log_extra(route_log, "route to target GUID %s gone",
 				guid_hex_str(guid));
 			gnet_stats_count_dropped(sender, MSG_DROP_ROUTE_LOST);
@@ -2666,7 +2789,7 @@ route_query_hit(struct route_log *route_log,
 				message_add(origin_guid, QUERY_HIT_ROUTE_SAVE, sender);
 				route_starving_check(origin_guid);
 			}
-		} else if (m->routes == NULL || !route_node_sent_message(sender, m)) {
+		} else if (0 == m->routes || !route_node_sent_message(sender, m)) {
 			struct route_data *route;
 
 			/*
@@ -2686,9 +2809,7 @@ route_query_hit(struct route_log *route_log,
 			 * no recording of the TTLs at which we see it.
 			 */
 
-			g_assert(m->ttls == NULL);
-
-			m->routes = pslist_append(m->routes, route);
+			message_route_append(m, route, 0);
 			route->saved_messages++;
 
 			/*
@@ -2741,7 +2862,7 @@ route_query_hit(struct route_log *route_log,
 	 * none of the nodes that sent us the request are connected any more.
 	 */
 
-	if (m->routes == NULL)
+	if (0 == m->routes)
 		goto route_lost;
 
 	if (route_node_sent_message(fake_node, m)) {
@@ -2778,12 +2899,12 @@ route_query_hit(struct route_log *route_log,
 	 * XXX route for relaying. --RAM, 2004-08-29
 	 */
 	{
-		pslist_t *sl;
+		unsigned i;
 		bool skipped_transient = FALSE;
 
 		found = NULL;
-		PSLIST_FOREACH(m->routes, sl) {
-			struct route_data *route = sl->data;
+		for (i = 0; i < m->routes; i++) {
+			struct route_data *route = message_route_rd(m, i);
 
 			g_assert(route);
 			g_assert(route->node);
@@ -2806,7 +2927,7 @@ route_query_hit(struct route_log *route_log,
 				 * will be logged as a message targeted to a transient node.
 				 */
 
-				if (NULL != pslist_next(sl)) {
+				if (i + 1 < m->routes) {
 					gnutella_node_t *rn;
 
 					rn = route_node_get_gnutella(route->node);
@@ -2927,6 +3048,8 @@ handle:
 bool
 route_message(gnutella_node_t **node, struct route_dest *dest)
 {
+	PROF_REGION(prof_route, "route-message");
+	uint64 start = prof_start();
 	bool handle_it = FALSE;
 	gnutella_node_t *sender = *node;
 	struct message *m;
@@ -3063,6 +3186,8 @@ done:
 		gnutella_header_set_ttl(&sender->header,
 			gnutella_header_get_ttl(&sender->header) - 1);
 
+	prof_end(&prof_route, start);
+
 	return !duplicate && handle_it;		/* Don't handle duplicates */
 }
 
@@ -3077,7 +3202,7 @@ route_exists_for_reply(const struct guid *muid, uint8 function)
 {
 	struct message *m;
 
-	if (!find_message(muid, function & ~0x01, &m) || m->routes == NULL)
+	if (!find_message(muid, function & ~0x01, &m) || 0 == m->routes)
 		return FALSE;
 
 	return TRUE;
@@ -3116,11 +3241,12 @@ route_towards_guid(const struct guid *guid)
 		return pslist_prepend(NULL, node);
 
 	if (find_message(guid, QUERY_HIT_ROUTE_SAVE, &m) && m->routes) {
-		pslist_t *iter, *nodes = NULL;
+		pslist_t *nodes = NULL;
+		unsigned i;
 
 		revitalize_entry(m, TRUE);
-		PSLIST_FOREACH(m->routes, iter) {
-			struct route_data *rd = iter->data;
+		for (i = 0; i < m->routes; i++) {
+			struct route_data *rd = message_route_rd(m, i);
 			nodes = pslist_prepend(nodes, rd->node);
 		}
 		return nodes;
@@ -82,6 +82,7 @@
 #include "lib/htable.h"
 #include "lib/listener.h"
 #include "lib/mime_type.h"
+#include "lib/prof.h"
 #include "lib/pslist.h"
 #include "lib/str.h"
 #include "lib/stringify.h"
@@ -751,6 +752,8 @@ shared_files_match(const char *query,
 	st_search_callback callback, void *user_data,
 	int max_res, uint32 flags, query_hashvec_t *qhv)
 {
+	PROF_REGION(prof_match, "query-match");
+	uint64 start = prof_start();
 	int n;
 	int remain;
 	search_table_t *gt, *pt;
@@ -794,6 +797,8 @@ shared_files_match(const char *query,
 
 	st_free(&gt);
 	st_free(&pt);
+
+	prof_end(&prof_match, start);
 }
 
 /**
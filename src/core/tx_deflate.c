@@ -47,6 +47,7 @@
 #include "lib/cq.h"
 #include "lib/endian.h"
 #include "lib/mempcpy.h"
+#include "lib/prof.h"
 #include "lib/tm.h"
 #include "lib/walloc.h"
 #include "lib/zlib_util.h"
@@ -120,6 +121,8 @@ struct attr {
 static void deflate_nagle_timeout(cqueue_t *cq, void *arg);
 static size_t tx_deflate_pending(txdrv_t *tx);
 
+PROF_REGION(prof_deflate, "deflate");
+
 #define tx_deflate_debugging(lvl) \
 	G_UNLIKELY(GNET_PROPERTY(tx_deflate_debug) > (lvl) && \
 		tx_debug_host(&tx->host))
@@ -390,6 +393,7 @@ deflate_flush(txdrv_t *tx)
 	struct buffer *b;
 	int ret;
 	int old_avail;
+	uint64 start;
 
 retry:
 	b = &attr->buf[attr->fill_idx];	/* Buffer we fill */
@@ -418,7 +422,9 @@ retry:
 
 	g_assert(outz->avail_out > 0);
 
+	start = prof_start();
 	ret = deflate(outz, (tx->flags & TX_CLOSING) ? Z_FINISH : Z_SYNC_FLUSH);
+	prof_end(&prof_deflate, start);
 
 	switch (ret) {
 	case Z_BUF_ERROR:				/* Nothing to flush */
@@ -579,6 +585,7 @@ deflate_add(txdrv_t *tx, const void *data, int len)
 		bool flush_started = (attr->flags & DF_FLUSH) ? TRUE : FALSE;
 		int old_avail;
 		const char *in, *old_in;
+		uint64 start;
 
 		/*
 		 * Prepare call to deflate().
@@ -602,7 +609,9 @@ deflate_add(txdrv_t *tx, const void *data, int len)
 		 * that we have more room available for the output.
 		 */
 
+		start = prof_start();
 		ret = deflate(outz, flush_started ? Z_SYNC_FLUSH : 0);
+		prof_end(&prof_deflate, start);
 
 		if (Z_OK != ret) {
 			attr->flags |= DF_SHUTDOWN;
@@ -63,6 +63,7 @@
 #include "lib/bstr.h"
 #include "lib/host_addr.h"
 #include "lib/pmsg.h"
+#include "lib/prof.h"
 #include "lib/pslist.h"
 #include "lib/random.h"
 #include "lib/sectoken.h"
@@ -246,7 +247,11 @@ kmsg_handle(knode_t *kn,
 				g_warning("DHT unhandled %s from %s",
 					km->name, knode_to_string(kn));
 		} else {
+			PROF_REGION(prof_kmsg, "dht-rpc");
+			uint64 start = prof_start();
+
 			km->handler(kn, n, header, extlen, payload, len);
+			prof_end(&prof_kmsg, start);
 		}
 	}
 }
@@ -90,6 +90,10 @@ kuid_is_blank(const kuid_t *kuid)
  * Compare three KUIDs with the XOR distance, to determine whether `kuid1' is
  * closer to `target' than `kuid2'.
  *
+ * KUIDs are processed 32 bits at a time, as 5 big-endian words: this routine
+ * is called for every comparison made when sorting nodes by distance in
+ * lookups, the routing table and the roots cache.
+ *
  * @param target	the target KUID we want to get the closest to
  * @param kuid1		KUID #1
  * @param kuid2		KUID #2
@@ -102,14 +106,15 @@ kuid_cmp3(const kuid_t *target, const kuid_t *kuid1, const kuid_t *kuid2)
 {
 	int i;
 
-	for (i = 0; i < KUID_RAW_SIZE; i++) {
-		uint d1 = kuid1->v[i] ^ target->v[i];
-		uint d2 = kuid2->v[i] ^ target->v[i];
+	STATIC_ASSERT(0 == KUID_RAW_SIZE % 4);
+
+	for (i = 0; i < KUID_RAW_SIZE; i += 4) {
+		uint32 t = peek_be32(&target->v[i]);
+		uint32 d1 = peek_be32(&kuid1->v[i]) ^ t;
+		uint32 d2 = peek_be32(&kuid2->v[i]) ^ t;
 
-		if (d1 < d2)
-			return -1;
-		else if (d2 < d1)
-			return +1;
+		if (d1 != d2)
+			return d1 < d2 ? -1 : +1;
 	}
 
 	return 0;
@@ -126,14 +131,12 @@ kuid_cmp(const kuid_t *k1, const kuid_t *k2)
 {
 	int i;
 
-	for (i = 0; i < KUID_RAW_SIZE; i++) {
-		uint b1 = k1->v[i];
-		uint b2 = k2->v[i];
+	for (i = 0; i < KUID_RAW_SIZE; i += 4) {
+		uint32 w1 = peek_be32(&k1->v[i]);
+		uint32 w2 = peek_be32(&k2->v[i]);
 
-		if (b1 < b2)
-			return -1;
-		else if (b2 < b1)
-			return +1;
+		if (w1 != w2)
+			return w1 < w2 ? -1 : +1;
 	}
 
 	return 0;
@@ -147,8 +150,8 @@ kuid_xor_distance(kuid_t *res, const kuid_t *k1, const kuid_t *k2)
 {
 	int i;
 
-	for (i = 0; i < KUID_RAW_SIZE; i++) {
-		res->v[i] = k1->v[i] ^ k2->v[i];
+	for (i = 0; i < KUID_RAW_SIZE; i += 4) {
+		poke_u32(&res->v[i], peek_u32(&k1->v[i]) ^ peek_u32(&k2->v[i]));
 	}
 }
 
@@ -724,6 +724,7 @@ lookup_final_stats(const nlookup_t *nl)
 		stats.rpc_replies = nl->rpc_replies;
 		stats.bw_outgoing = nl->bw_outgoing;
 		stats.bw_incoming = nl->bw_incoming;
+		stats.hops = nl->hops;
 
 		(*nl->stats)(nl->kuid, &stats, nl->arg);
 	}
@@ -74,6 +74,7 @@ struct lookup_stats {
 	int rpc_replies;			/**< Amount of valid RPC replies */
 	int bw_outgoing;			/**< Amount of outgoing bandwidth used */
 	int bw_incoming;			/**< Amount of incoming bandwidth used */
+	unsigned hops;				/**< Amount of hops (iterations) done */
 };
 
 /**
@@ -91,8 +91,9 @@
 #define ROOTS_SYNC_PERIOD	60000		/**< Flush DB every minute */
 
 #define ROOTKEYS_DB_CACHE_SIZE	512		/**< Cached amount of root keys */
+#define ROOTKEYS_MAP_CACHE_SIZE	1024	/**< Amount of SDBM pages to cache */
 #define CONTACT_DB_CACHE_SIZE	4096	/**< Cached amount of contacts */
-#define CONTACT_MAP_CACHE_SIZE	128		/**< Amount of SDBM pages to cache */
+#define CONTACT_MAP_CACHE_SIZE	1024	/**< Amount of SDBM pages to cache */
 
 /**
  * Private callout queue used to expire entries in the database that have
@@ -1135,6 +1136,8 @@ roots_init(void)
 		ROOTKEYS_DB_CACHE_SIZE, kuid_hash, kuid_eq,
 		GNET_PROPERTY(dht_storage_in_memory));
 
+	dbmw_set_map_cache(db_rootdata, ROOTKEYS_MAP_CACHE_SIZE);
+
 	db_contact = dbstore_open(db_contact_what, settings_dht_db_dir(),
 		db_contact_base, contact_kv, contact_packing,
 		CONTACT_DB_CACHE_SIZE, uint64_mem_hash, uint64_mem_eq,
@@ -107,6 +107,7 @@
 #include "lib/tokenizer.h"
 #include "lib/vendors.h"
 #include "lib/walloc.h"
+#include "lib/xsort.h"
 
 #include "lib/override.h"		/* Must be the last header included */
 
@@ -4413,16 +4414,112 @@ dht_size(void)
 }
 
 /**
- * GList sort callback.
+ * A candidate node for dht_fill_closest(), with its distance to the target.
+ */
+struct closest_node {
+	kuid_t dist;				/**< XOR distance to the target KUID */
+	knode_t *kn;				/**< The candidate node */
+};
+
+/**
+ * Context for fill_closest_in_bucket() traversal callbacks.
+ */
+struct closest_ctx {
+	struct closest_node vec[K_BUCKET_GOOD + K_BUCKET_STALE + K_BUCKET_PENDING];
+	const kuid_t *id;			/**< Target KUID */
+	const kuid_t *exclude;		/**< KUID to exclude (NULL if none) */
+	time_t now;					/**< Current time, for pending nodes */
+	size_t count;				/**< Amount of candidates in vector */
+	bool alive;					/**< Whether we want only alive nodes */
+};
+
+/**
+ * xsort() callback to order candidates by increasing distance to the target.
  */
 static int
-distance_to(const void *a, const void *b, void *user_data)
+closest_node_cmp(const void *a, const void *b)
+{
+	const struct closest_node *ca = a, *cb = b;
+
+	return kuid_cmp(&ca->dist, &cb->dist);
+}
+
+/**
+ * Record node as a candidate, computing its distance to the target.
+ */
+static void
+closest_ctx_add(struct closest_ctx *ctx, knode_t *kn)
+{
+	struct closest_node *cn;
+
+	g_assert(ctx->count < N_ITEMS(ctx->vec));
+
+	cn = &ctx->vec[ctx->count++];
+	kuid_xor_distance(&cn->dist, kn->id, ctx->id);
+	cn->kn = kn;
+}
+
+/**
+ * hash_list_foreach() callback to collect good nodes.
+ */
+static void
+closest_add_good(void *data, void *udata)
+{
+	knode_t *kn = data;
+	struct closest_ctx *ctx = udata;
+
+	knode_check(kn);
+	g_assert(KNODE_GOOD == kn->status);
+
+	if (
+		(!ctx->exclude || !kuid_eq(kn->id, ctx->exclude)) &&
+		(!ctx->alive || (kn->flags & KNODE_F_ALIVE))
+	)
+		closest_ctx_add(ctx, kn);
+}
+
+/**
+ * hash_list_foreach() callback to collect stale nodes.
+ */
+static void
+closest_add_stale(void *data, void *udata)
+{
+	knode_t *kn = data;
+	struct closest_ctx *ctx = udata;
+
+	knode_check(kn);
+	g_assert(KNODE_STALE == kn->status);
+
+	if (
+		(!ctx->exclude || !kuid_eq(kn->id, ctx->exclude)) &&
+		knode_still_alive_probability(kn) >= ALIVE_PROBA_LOW_THRESH
+	)
+		closest_ctx_add(ctx, kn);
+}
+
+/**
+ * hash_list_foreach() callback to collect pending nodes.
+ */
+static void
+closest_add_pending(void *data, void *udata)
 {
-	const knode_t *ka = a;
-	const knode_t *kb = b;
-	const kuid_t *id = user_data;
+	knode_t *kn = data;
+	struct closest_ctx *ctx = udata;
+
+	knode_check(kn);
+	g_assert(KNODE_PENDING == kn->status);
 
-	return kuid_cmp3(id, ka->id, kb->id);
+	if (
+		!(kn->flags & KNODE_F_SHUTDOWNING) &&
+		(!ctx->exclude || !kuid_eq(kn->id, ctx->exclude)) &&
+		(!ctx->alive ||
+			(
+				(kn->flags & KNODE_F_ALIVE) &&
+				delta_time(ctx->now, kn->last_seen) < alive_period()
+			)
+		)
+	)
+		closest_ctx_add(ctx, kn);
 }
 
 /**
@@ -4430,6 +4527,10 @@ distance_to(const void *a, const void *b, void *user_data)
  * nodes from the current bucket, inserting them by increasing distance
  * to the supplied ID.
  *
+ * This is called for every incoming FIND_NODE and for each of our lookups,
+ * so candidates are collected in a vector on the stack, with their distance
+ * to the target computed once, instead of building and sorting lists.
+ *
  * @param id		the KUID for which we're finding the closest neighbours
  * @param kb		the bucket used
  * @param kvec		base of the "knode_t *" vector
@@ -4444,14 +4545,19 @@ fill_closest_in_bucket(
 	const kuid_t *id, struct kbucket *kb,
 	knode_t **kvec, int kcnt, const kuid_t *exclude, bool alive)
 {
-	plist_t *nodes = NULL, *good, *l;
+	struct closest_ctx ctx;
+	size_t i;
 	int added;
-	int available = 0;
 
 	g_assert(id);
 	g_assert(is_leaf(kb));
 	g_assert(kvec);
 
+	ctx.id = id;
+	ctx.exclude = exclude;
+	ctx.alive = alive;
+	ctx.count = 0;
+
 	/*
 	 * If we can determine that we do not have enough good nodes in the bucket
 	 * to fill the vector, consider "stale" nodes and then "pending" nodes
@@ -4459,24 +4565,7 @@ fill_closest_in_bucket(
 	 * recently (defined by the aliveness period).
 	 */
 
-	good = hash_list_list(kb->nodes->good);
-
-	while (good != NULL) {
-		knode_t *kn = good->data;
-
-		knode_check(kn);
-		g_assert(KNODE_GOOD == kn->status);
-
-		if (
-			(!exclude || !kuid_eq(kn->id, exclude)) &&
-			(!alive || (kn->flags & KNODE_F_ALIVE))
-		) {
-			nodes = plist_prepend(nodes, kn);
-			available++;
-		}
-
-		good = plist_remove(good, kn);
-	}
+	hash_list_foreach(kb->nodes->good, closest_add_good, &ctx);
 
 	/*
 	 * Only stale nodes that are still somewhat likely to be alive are
@@ -4489,57 +4578,16 @@ fill_closest_in_bucket(
 	 * without having to ping them explicitly.
 	 */
 
-	if (!alive) {
-		plist_t *stale = hash_list_list(kb->nodes->stale);
-
-		while (stale != NULL) {
-			knode_t *kn = stale->data;
-
-			knode_check(kn);
-			g_assert(KNODE_STALE == kn->status);
-
-			if (
-				(!exclude || !kuid_eq(kn->id, exclude)) &&
-				knode_still_alive_probability(kn) >= ALIVE_PROBA_LOW_THRESH
-			) {
-				nodes = plist_prepend(nodes, kn);
-				available++;
-			}
-
-			stale = plist_remove(stale, kn);
-		}
-	}
+	if (!alive)
+		hash_list_foreach(kb->nodes->stale, closest_add_stale, &ctx);
 
 	/*
 	 * Pending nodes come last, if we miss nodes.
 	 */
 
-	if (available < kcnt) {
-		plist_t *pending = hash_list_list(kb->nodes->pending);
-		time_t now = tm_time();
-
-		while (pending != NULL) {
-			knode_t *kn = pending->data;
-
-			knode_check(kn);
-			g_assert(KNODE_PENDING == kn->status);
-
-			if (
-				!(kn->flags & KNODE_F_SHUTDOWNING) &&
-				(!exclude || !kuid_eq(kn->id, exclude)) &&
-				(!alive ||
-					(
-						(kn->flags & KNODE_F_ALIVE) &&
-						delta_time(now, kn->last_seen) < alive_period()
-					)
-				)
-			) {
-				nodes = plist_prepend(nodes, kn);
-				available++;
-			}
-
-			pending = plist_remove(pending, kn);
-		}
+	if (ctx.count < (size_t) kcnt) {
+		ctx.now = tm_time();
+		hash_list_foreach(kb->nodes->pending, closest_add_pending, &ctx);
 	}
 
 	/*
@@ -4547,16 +4595,14 @@ fill_closest_in_bucket(
 	 * insert them in the vector.
 	 */
 
-	nodes = plist_sort_with_data(nodes, distance_to, deconstify_pointer(id));
+	xsort(ctx.vec, ctx.count, sizeof ctx.vec[0], closest_node_cmp);
 
-	for (added = 0, l = nodes; l && kcnt; l = plist_next(l)) {
-		*kvec++ = l->data;
+	for (added = 0, i = 0; i < ctx.count && kcnt; i++) {
+		*kvec++ = ctx.vec[i].kn;
 		kcnt--;
 		added++;
 	}
 
-	plist_free(nodes);
-
 	return added;
 }
 
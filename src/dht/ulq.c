@@ -151,6 +151,7 @@ static struct ulq_sched {
 	int bw_out_ema;					/**< Slow EMA of outgoing b/w per lookup */
 	int sz_in_ema;					/**< Slow EMA of incoming message size */
 	int sz_out_ema;					/**< Slow EMA of outgoing message size */
+	int hops_ema;					/**< Slow EMA of hops per lookup */
 	int msg_dropped;				/**< Exponentially decaying # of drops */
 	bool udp_flow_controlled;		/**< Whether UDP was flow-controlled */
 } sched;
@@ -349,6 +350,9 @@ ulq_lookup_stats(const kuid_t *kuid,
 		sched.sz_out_ema += (avg >> 4) - (sched.sz_out_ema >> 4);
 	}
 
+	avg = ls->hops << ULQ_EMA_SHIFT;
+	sched.hops_ema += (avg >> 4) - (sched.hops_ema >> 4);
+
 	/*
 	 * Exponential decay of number of messages dropped.
 	 */
@@ -359,15 +363,17 @@ ulq_lookup_stats(const kuid_t *kuid,
 	sched.msg_dropped -= sched.msg_dropped >> 1;	/* Halve the count */
 
 	if (GNET_PROPERTY(dht_ulq_debug) > 1)
-		g_debug("DHT ULQ %s lookup completed in %g secs (in=%d, out=%d)",
-			ui->uq->name, ls->elapsed, ls->bw_incoming, ls->bw_outgoing);
+		g_debug("DHT ULQ %s lookup completed in %g secs "
+			"(in=%d, out=%d, hops=%u, sent=%d)",
+			ui->uq->name, ls->elapsed, ls->bw_incoming, ls->bw_outgoing,
+			ls->hops, ls->msg_sent);
 
 	if (GNET_PROPERTY(dht_ulq_debug) > 2)
 		g_debug("DHT ULQ sched avg: "
-			"bw_in=%d, bw_out=%d, sz_in=%d, sz_out=%d, dropped=%d",
+			"bw_in=%d, bw_out=%d, sz_in=%d, sz_out=%d, hops=%d, dropped=%d",
 			vema(sched.bw_in_ema), vema(sched.bw_out_ema),
 			vema(sched.sz_in_ema), vema(sched.sz_out_ema),
-			sched.msg_dropped);
+			vema(sched.hops_ema), sched.msg_dropped);
 }
 
 /**
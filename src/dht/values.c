@@ -1911,8 +1911,16 @@ values_get(uint64 dbkey, dht_value_type_t type)
 	 * OK, we have a value and its type matches.  Build the DHT value.
 	 */
 
+	/*
+	 * The request counter is only informational (logged when the value
+	 * expires), so it is updated in the cached copy without marking the
+	 * entry dirty: issuing a dbmw_write() here turned every FIND_VALUE hit
+	 * into a deferred database write.  The count is persisted whenever the
+	 * value is rewritten for other reasons, and may otherwise be lost when
+	 * the entry leaves the cache, which is fine.
+	 */
+
 	vd->n_requests++;
-	dbmw_write(db_valuedata, &dbkey, PTRLEN(vd));
 
 	if (vd->length) {
 		size_t length;
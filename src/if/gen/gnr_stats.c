@@ -1,5 +1,5 @@
 /*
- * Generated on Wed Aug  8 14:55:47 2018 by enum-msg.pl -- DO NOT EDIT
+ * Generated on Mon Oct 19 15:04:35 2026 by enum-msg.pl -- DO NOT EDIT
  *
  * Command: ../../../scripts/enum-msg.pl stats.lst
  */
@@ -429,6 +429,9 @@ static const char *stats_symbols[] = {
 	"stats_digest",
 	"stats_tcp_digest",
 	"stats_udp_digest",
+	"dmesh_sha1_held",
+	"dmesh_entries_held",
+	"dmesh_guid_indexes_held",
 };
 
 /**
@@ -864,6 +867,9 @@ static const char *stats_text[] = {
 	N_("Digests computed on general statistics"),
 	N_("Digests computed on TCP statistics"),
 	N_("Digests computed on UDP statistics"),
+	N_("Download mesh SHA1s held"),
+	N_("Download mesh entries held"),
+	N_("Download mesh firewalled entry indexes held"),
 };
 
 /**
@@ -1,5 +1,5 @@
 /*
- * Generated on Wed Aug  8 14:55:47 2018 by enum-msg.pl -- DO NOT EDIT
+ * Generated on Mon Oct 19 15:04:35 2026 by enum-msg.pl -- DO NOT EDIT
  *
  * Command: ../../../scripts/enum-msg.pl stats.lst
  */
@@ -8,7 +8,7 @@
 #define _if_gen_gnr_stats_h_
 
 /*
- * Enum count: 414
+ * Enum count: 417
  */
 typedef enum {
 	GNR_ROUTING_ERRORS = 0,
@@ -425,6 +425,9 @@ typedef enum {
 	GNR_STATS_DIGEST,
 	GNR_STATS_TCP_DIGEST,
 	GNR_STATS_UDP_DIGEST,
+	GNR_DMESH_SHA1_HELD,
+	GNR_DMESH_ENTRIES_HELD,
+	GNR_DMESH_GUID_INDEXES_HELD,
 
 	GNR_TYPE_COUNT
 } gnr_stats_t;
@@ -1060,24 +1060,27 @@ atom_is_atom(enum atom_type type, const void *key)
  *
  * Must be called with the table description locked.
  *
+ * @param vp		address of the atom's value in the hash table
+ * @param delta		reference count adjustment
+ *
  * @return new reference count.
  */
 static inline size_t
-atom_refcnt_add(const atom_desc_t *ad, const void *key, void *value, int delta)
+atom_refcnt_add(void **vp, int delta)
 {
 	if (4 == sizeof(void *)) {
 		/* 32-bit machine, we can directly update the atom_info structure */
-		struct atom_info *ai = value;
+		struct atom_info *ai = *vp;
 		ai->refcnt += delta;
 		return ai->refcnt;
 	} else {
-		/* 64-bit machine, we must update the hash table value */
-		ulong v = pointer_to_ulong(value);
+		/* 64-bit machine, we update the hash table value in place */
+		ulong v = pointer_to_ulong(*vp);
 		if (delta > 0)
 			v += delta;
 		else
 			v -= -delta;	/* Necessary since int may be smaller than long */
-		htable_insert(ad->table, key, ulong_to_pointer(v));
+		*vp = ulong_to_pointer(v);
 		return ATOM_REFCNT(v);
 	}
 }
@@ -1093,7 +1096,7 @@ atom_get(enum atom_type type, const void *key)
 {
 	atom_desc_t *ad;
 	const void *orig_key;
-	void *value;
+	void **vp;
 	size_t size;
 	atom_t *a;
 
@@ -1110,10 +1113,17 @@ atom_get(enum atom_type type, const void *key)
 	ad = &atoms[type];		/* Where atoms of this type are held */
 	ATOM_TABLE_LOCK(ad);
 
-	if (htable_lookup_extended(ad->table, key, &orig_key, &value)) {
+	/*
+	 * Fetching the address of the value lets us update the reference count
+	 * of an existing atom without hashing the key a second time.
+	 */
+
+	vp = htable_lookup_value_ptr(ad->table, key, &orig_key);
+
+	if (vp != NULL) {
 		size_t refcnt;
 
-		size = atom_info_length(value);
+		size = atom_info_length(*vp);
 		/* Prevent gcc warning if ARENA_OFFSET == 0 */
 		g_assert(size == ARENA_OFFSET || size > ARENA_OFFSET);
 
@@ -1121,9 +1131,9 @@ atom_get(enum atom_type type, const void *key)
 		 * Atom exists, increment ref count and return it.
 		 */
 
-		g_assert(atom_info_refcnt(value) > 0);
+		g_assert(atom_info_refcnt(*vp) > 0);
 
-		refcnt = atom_refcnt_add(ad, orig_key, value, +1);
+		refcnt = atom_refcnt_add(vp, +1);
 		ATOM_TRACK_REFCNT(orig_key, +1, refcnt);
 		ATOM_TABLE_UNLOCK(ad);
 
@@ -1178,9 +1188,8 @@ atom_free(enum atom_type type, const void *key)
 	atom_desc_t *ad;
 	size_t size;
 	atom_t *a;
-	bool found;
 	int refcnt;
-	void *value;
+	void *value, **vp;
 	const void *orig_key;
 
     g_assert(key != NULL);
@@ -1190,14 +1199,15 @@ atom_free(enum atom_type type, const void *key)
 	ad = &atoms[type];		/* Where atoms of this type are held */
 	ATOM_TABLE_LOCK(ad);
 
-	found = htable_lookup_extended(ad->table, key, &orig_key, &value);
+	vp = htable_lookup_value_ptr(ad->table, key, &orig_key);
 
-	g_assert_log(found,
+	g_assert_log(vp != NULL,
 		"attempting to free unknown %s atom at %p", ad->type, key);
 	g_assert_log(key == orig_key,
 		"attempt to free %s atom copy at %p, atom was at %p",
 			ad->type, key, orig_key);
 
+	value = *vp;
 	size = atom_info_length(value);
 
 	/* Prevent gcc warning if ARENA_OFFSET == 0 */
@@ -1220,7 +1230,7 @@ atom_free(enum atom_type type, const void *key)
 		atom_unprotect(a, size);
 		atom_dealloc(a, size);
 	} else {
-		size_t rcnt = atom_refcnt_add(ad, key, value, -1);
+		size_t rcnt = atom_refcnt_add(vp, -1);
 		ATOM_TRACK_REFCNT(key, -1, rcnt);
 	}
 
@@ -50,6 +50,13 @@
  * estimate the time cost for a tick to be able to dynamically adjust the
  * amount of requested ticks.
  *
+ * Each run of a task is given a time budget, its share of the scheduler's
+ * time slice.  The real time elapsed and the CPU time used by each run are
+ * measured.  When a run exceeds its budget, the amount of ticks computed
+ * from the tick cost measured during that run is applied right away, not
+ * limited by DELTA_FACTOR.  Steps whose work per tick is very irregular
+ * can also call bg_task_over_budget() to return early to the scheduler.
+ *
  * Each step is a routine that can return four statuses:
  *
  * BGR_MORE to request that the scheduler continues to run this step
@@ -117,6 +124,7 @@
 #include "pslist.h"
 #include "spinlock.h"
 #include "stacktrace.h"
+#include "stall.h"
 #include "str.h"
 #include "stringify.h"		/* For short_time_ascii() and plural() */
 #include "tm.h"
@@ -160,6 +168,7 @@ struct bgsched {
 	size_t completed;			/**< Completed tasks */
 	ulong max_life;				/**< Maximum life when scheduled, in usecs */
 	ulong wtime;				/**< Wall-clock run time, in ms */
+	uint64 cputime;				/**< CPU time used by tasks, in usecs */
 	int runcount;				/**< Amount of runnable tasks */
 	int period;					/**< Scheduling period for callout, in ms */
 	unsigned stid;				/**< Thread running scheduler, -1 if unknown */
@@ -216,6 +225,8 @@ struct bgtask {
 	void *ucontext;			/**< User context */
 	time_t created;			/**< Creation time */
 	ulong wtime;			/**< Wall-clock run time sofar, in ms */
+	uint64 cputime;			/**< CPU time used sofar, in usecs */
+	uint64 cstart;			/**< Thread CPU time when last resumed, usecs */
 	bgclean_cb_t uctx_free;	/**< Free routine for context */
 	bgdone_cb_t done_cb;	/**< Called when done */
 	void *done_arg;			/**< "done" callback argument */
@@ -228,6 +239,9 @@ struct bgtask {
 	int ticks_used;			/**< Amount of ticks used by processing step */
 	int prev_ticks;			/**< Ticks used when measuring `elapsed' below */
 	int elapsed;			/**< Elapsed during last run, in usec */
+	int target;				/**< Time budget of last run, in usec (0 = none) */
+	int max_elapsed;		/**< Longest run, in usec */
+	uint overruns;			/**< Runs that exceeded their time budget */
 	double tick_cost;		/**< Time in ms. spent by each tick */
 	bgsig_cb_t sigh[BG_SIG_COUNT];	/**< Signal handlers */
 	spinlock_t lock;		/**< Thread-safe lock */
@@ -725,6 +739,7 @@ static void
 bg_task_suspend(bgtask_t *bt, int target)
 {
 	time_delta_t elapsed;
+	uint64 cpu;
 
 	bg_task_check(bt);
 	g_assert(bt->flags & TASK_F_RUNNING);
@@ -741,6 +756,21 @@ bg_task_suspend(bgtask_t *bt, int target)
 	bt->elapsed = elapsed;
 	bt->wtime += (elapsed + 500) / 1000;	/* wtime is in ms */
 	bt->prev_ticks = bt->ticks_used;
+	bt->max_elapsed = MAX(bt->max_elapsed, elapsed);
+
+	if (target != 0 && elapsed > target)
+		bt->overruns++;
+
+	/*
+	 * Update CPU time used by the task, when we can measure it.
+	 */
+
+	cpu = tm_thread_cputime();
+
+	if (cpu != 0 && cpu >= bt->cstart) {
+		bt->cputime += cpu - bt->cstart;
+		bt->sched->cputime += cpu - bt->cstart;
+	}
 
 	/*
 	 * Now update the tick cost, if elapsed is not null.
@@ -793,6 +823,7 @@ bg_task_resume(bgtask_t *bt)
 	bt->flags |= TASK_F_RUNNING;
 
 	tm_now_exact(&bt->start);
+	bt->cstart = tm_thread_cputime();
 }
 
 /**
@@ -1859,6 +1890,24 @@ bg_task_ticks_used(bgtask_t *bt, int used)
 	}
 }
 
+/**
+ * This routine can be called by a running task to check whether it has
+ * exhausted the time budget of its current run.
+ *
+ * Steps for which the cost of a tick varies widely can call this within
+ * their processing loop to return early to the scheduler, after calling
+ * bg_task_ticks_used() to report the amount of ticks they actually used.
+ *
+ * @return TRUE if the current run of the task exceeded its time budget.
+ */
+bool
+bg_task_over_budget(bgtask_t *bt)
+{
+	bg_task_is_running(bt, G_STRFUNC);
+
+	return bt->target != 0 && bg_task_elapsed(bt) >= bt->target;
+}
+
 /**
  * This routine can be called by a running task to request that it be put
  * to sleep as soon as its current step is finished.
@@ -2151,6 +2200,7 @@ bg_sched_timer(void *arg)
 	bgret_t ret;
 	unsigned stid;
 	tm_t start;
+	struct stall_cb sc;
 
 	bg_sched_check(bs);
 	g_assert(NULL == bs->current_task);
@@ -2208,7 +2258,10 @@ bg_sched_timer(void *arg)
 		 * Compute how many ticks we can ask for this processing step.
 		 *
 		 * We don't allow brutal variations of the amount of ticks larger
-		 * than DELTA_FACTOR.
+		 * than DELTA_FACTOR, unless the task exceeded its time budget during
+		 * its last run: we must then immediately scale down the amount of
+		 * ticks computed from the tick cost measured during that run, or
+		 * it would keep stalling the thread running the scheduler.
 		 */
 
 		if (bt->tick_cost > 0.0) {
@@ -2223,7 +2276,10 @@ bg_sched_timer(void *arg)
 			if (bt->prev_ticks) {
 				if (ticks > bt->prev_ticks * DELTA_FACTOR) {
 					ticks = bt->prev_ticks * DELTA_FACTOR;
-				} else if (ticks < bt->prev_ticks / DELTA_FACTOR) {
+				} else if (
+					ticks < bt->prev_ticks / DELTA_FACTOR &&
+					(0 == bt->target || bt->elapsed <= bt->target)
+				) {
 					if (bt->prev_ticks > DELTA_FACTOR)
 						ticks = bt->prev_ticks / DELTA_FACTOR;
 					else
@@ -2236,6 +2292,7 @@ bg_sched_timer(void *arg)
 		}
 		bt->ticks = ticks;
 		bt->ticks_used = ticks;
+		bt->target = target;
 
 		/*
 		 * Switch to the selected task.
@@ -2356,7 +2413,15 @@ bg_sched_timer(void *arg)
 
 		g_assert(bt->step < bt->stepcnt);
 
+		/*
+		 * If the step calls bg_task_exit(), stall_cb_leave() is skipped,
+		 * which is harmless: the enclosing callout queue event restores
+		 * the stall detection context when it returns.
+		 */
+
+		stall_cb_enter(&sc, func_to_pointer(bt->stepvec[bt->step]));
 		ret = (*bt->stepvec[bt->step])(bt, bt->ucontext, ticks);
+		stall_cb_leave(&sc);
 
 		/*
 		 * We stopped running the task, we're now in "kernel" mode.
@@ -2669,6 +2734,9 @@ bg_info_get(void *data, void *udata)
 	bi->sname = atom_str_get(v->bs->name);
 	bi->stid = v->bs->stid;
 	bi->wtime = bt->wtime;
+	bi->ctime = (bt->cputime + 500) / 1000;
+	bi->max_run = bt->max_elapsed;
+	bi->overruns = bt->overruns;
 	bi->step = bt->step;
 	bi->seqno = bt->seqno;
 	bi->stepcnt = bt->stepcnt;
@@ -2779,6 +2847,7 @@ bg_sched_info_list(void)
 		bsi->completed = bs->completed;
 		bsi->stid = bs->stid;
 		bsi->wtime = bs->wtime;
+		bsi->ctime = (bs->cputime + 500) / 1000;
 		bsi->runq_count = eslist_count(&bs->runq);
 		bsi->sleepq_count = eslist_count(&bs->sleepq);
 		bsi->runcount = bs->runcount;
@@ -85,6 +85,9 @@ typedef struct {
 	const char *sname;		/**< Scheduler name (atom) */
 	uint stid;				/**< Scheduler's thread ID */
 	ulong wtime;			/**< Wall-clock run time sofar, in ms */
+	ulong ctime;			/**< CPU time used sofar, in ms */
+	uint max_run;			/**< Longest scheduled run, in usecs */
+	uint overruns;			/**< Runs that exceeded their time budget */
 	int step;				/**< Current processing step */
 	int seqno;				/**< Number of calls made to same step */
 	int stepcnt;			/**< Amount of steps */
@@ -114,6 +117,7 @@ typedef struct {
 	size_t completed;		/**< Amount of completed tasks */
 	uint stid;				/**< Scheduler's thread ID */
 	ulong wtime;			/**< Wall-clock run time, in ms */
+	ulong ctime;			/**< CPU time used by tasks, in ms */
 	uint runq_count;		/**< Run queue task count */
 	uint sleepq_count;		/**< Sleeping queue task count */
 	int runcount;			/**< Amount of runnable tasks */
@@ -202,6 +206,7 @@ void bg_task_sleep(bgtask_t *bt);
 void bg_task_wakeup(bgtask_t *bt);
 void bg_task_exit(bgtask_t *h, int code) G_NORETURN;
 void bg_task_ticks_used(bgtask_t *h, int used);
+bool bg_task_over_budget(bgtask_t *bt);
 bgsig_cb_t bg_task_signal(bgtask_t *h, bgsig_t sig, bgsig_cb_t handler);
 
 bgtask_t *bg_task_ref(bgtask_t *bt);
@@ -46,8 +46,10 @@
 #include "mutex.h"
 #include "once.h"
 #include "pow2.h"
+#include "prof.h"
 #include "pslist.h"
 #include "spinlock.h"
+#include "stall.h"
 #include "stacktrace.h"
 #include "stringify.h"
 #include "thread.h"
@@ -532,20 +534,39 @@ ev_link(cevent_t *ev)
 	}
 
 	/*
-	 * Insert before the first item whose trigger will come after ours.
+	 * Insert before the first item whose trigger will come after ours,
+	 * which is also right after the last item whose trigger is not after
+	 * ours.
+	 *
+	 * Buckets can grow long on a busy queue since they collect events from
+	 * several laps of the hash table, so we scan from the end whose trigger
+	 * time is closest to ours, assuming events are roughly evenly spread
+	 * in time within the bucket.
 	 */
 
-	for (hev = hev->ce_bnext; hev; hev = hev->ce_bnext) {
-		if (trigger < hev->ce_time) {
-			hev->ce_bprev->ce_bnext = ev;
-			ev->ce_bprev = hev->ce_bprev;
-			hev->ce_bprev = ev;
-			ev->ce_bnext = hev;
-			return;
+	if (trigger - hev->ce_time <= ch->ch_tail->ce_time - trigger) {
+		for (hev = hev->ce_bnext; hev; hev = hev->ce_bnext) {
+			if (trigger < hev->ce_time)
+				goto insert_before;
+		}
+	} else {
+		for (hev = ch->ch_tail->ce_bprev; hev; hev = hev->ce_bprev) {
+			if (trigger >= hev->ce_time) {
+				hev = hev->ce_bnext;
+				goto insert_before;
+			}
 		}
 	}
 
 	g_assert_not_reached();	/* Must have found an event to insert before */
+
+insert_before:
+	g_assert(hev != NULL);
+
+	hev->ce_bprev->ce_bnext = ev;
+	ev->ce_bprev = hev->ce_bprev;
+	hev->ce_bprev = ev;
+	ev->ce_bnext = hev;
 }
 
 /**
@@ -994,8 +1015,11 @@ cq_remaining(const cevent_t *ev)
 static void
 cq_expire_internal(cqueue_t *cq, cevent_t *ev)
 {
+	PROF_REGION(prof_cq_dispatch, "cq-dispatch");
 	cq_service_t fn;
 	void *arg;
+	uint64 start;
+	struct stall_cb sc;
 
 	assert_mutex_is_owned(&cq->cq_lock);
 
@@ -1044,7 +1068,11 @@ cq_expire_internal(cqueue_t *cq, cevent_t *ev)
 	g_assert(fn != NULL);
 
 	CQ_UNLOCK(cq);
+	start = prof_start();
+	stall_cb_enter(&sc, func_to_pointer(fn));
 	(*fn)(cq, arg);		/* Callback invoked with queue unlocked */
+	stall_cb_leave(&sc);
+	prof_end(&prof_cq_dispatch, start);
 	CQ_LOCK(cq);
 
 	/*
@@ -304,10 +304,14 @@ hash_arena_allocate(struct hash *h, size_t bits)
 
 	size = hash_arena_size(hk->size, hk->has_values);
 
-	if (size >= compat_pagesize() || hk->raw_memory)
+	if (size >= compat_pagesize() || hk->raw_memory) {
 		arena = vmm_alloc(size);
-	else
+		/* Large tables: fewer TLB misses */
+		hk->hugepage = booleanize(vmm_madvise_hugepage(arena, size));
+	} else {
 		arena = walloc(size);
+		hk->hugepage = FALSE;
+	}
 
 	hash_update_arena_pointers(h, arena);
 	memset(hk->hashes, 0, hk->size * sizeof(unsigned));
@@ -349,18 +353,43 @@ hash_arena_relocate(struct hash *h)
 	if (size < compat_pagesize() && !hk->raw_memory)
 		return;		/* Not allocated via VMM */
 
-	arena = vmm_move(hk->keys, size);
-	if G_LIKELY(arena == hk->keys)
-		return;		/* Not moved */
+	if (!vmm_is_relocatable(hk->keys, size))
+		return;
+
+	/*
+	 * An arena advised for huge pages needs to have the advice carried over
+	 * to its new location, and revoked on the old one, should it move.
+	 */
+
+	if (hk->hugepage) {
+		bool advised;
+
+		arena = vmm_move_hugepage(hk->keys, size, &advised);
+
+		if G_LIKELY(arena == hk->keys)
+			return;		/* Not moved */
+
+		hk->hugepage = booleanize(advised);
+	} else {
+		arena = vmm_move(hk->keys, size);
+
+		if G_LIKELY(arena == hk->keys)
+			return;		/* Not moved */
+	}
 
 	hash_update_arena_pointers(h, arena);
 }
 
 /**
  * Release arena of given length.
+ *
+ * @param arena		the arena to free
+ * @param len		arena length
+ * @param raw		whether the arena was allocated in "raw" mode
+ * @param hugepage	whether the arena was advised for huge pages
  */
 static void
-hash_arena_size_free(void *arena, size_t len, bool raw)
+hash_arena_size_free(void *arena, size_t len, bool raw, bool hugepage)
 {
 	/*
 	 * If the arena size is more than a page size, we used VMM to allocate the
@@ -369,10 +398,13 @@ hash_arena_size_free(void *arena, size_t len, bool raw)
 	 * When the hash is in "raw" mode, we avoid walloc().
 	 */
 
-	if (len >= compat_pagesize() || raw)
+	if (len >= compat_pagesize() || raw) {
+		if (hugepage)
+			vmm_madvise_nohugepage(arena, len);
 		vmm_free(arena, len);
-	else
+	} else {
 		wfree(arena, len);
+	}
 }
 
 /**
@@ -385,7 +417,8 @@ hash_arena_kset_free(struct hash *h)
 	size_t size;
 
 	size = hash_arena_size(hk->size, hk->has_values);
-	hash_arena_size_free(hk->keys, size, hk->raw_memory);
+	hash_arena_size_free(hk->keys, size, hk->raw_memory, hk->hugepage);
+	hk->hugepage = FALSE;
 }
 
 /**
@@ -431,12 +464,12 @@ hash_keyhash_setup(struct hkeys *hk, enum hash_key_type ktype, size_t keysize)
 		break;
 	case HASH_KEY_STRING:
 		hk->uh.h.hash = string_mix_hash;
-		hk->uh.h.hash2 = string_hash;
+		hk->uh.h.hash2 = NULL;		/* Derived from primary hash */
 		hk->uk.eq = string_eq;
 		break;
 	case HASH_KEY_FIXED:
 		hk->uh.h.hash = NULL;		/* Will use binary_hash() */
-		hk->uh.h.hash2 = NULL;		/* Will use binary_hash2() */
+		hk->uh.h.hash2 = NULL;		/* Derived from primary hash */
 		hk->uk.keysize = keysize;	/* Will use binary_eq() */
 		break;
 	case HASH_KEY_ANY:
@@ -515,15 +548,20 @@ hash_compute_primary(const struct hkeys *hk, const void *key)
  *
  * Makes sure the increment is odd so that it is prime with the table size
  * and non-zero at the same time.
+ *
+ * For strings and fixed-size keys, a secondary hash would need to read the
+ * whole key again on every collision.  Instead, the increment is derived
+ * from the byte-swapped primary hash, so that its low-order bits come from
+ * the part of the hash value that is not used to select the home slot:
+ * keys sharing a home slot still follow different probing paths unless
+ * their full primary hash values collide.
  */
 static inline unsigned
 hash_compute_increment(const struct hkeys *hk, const void *key, unsigned hv)
 {
 	unsigned hv2;
 
-	if (HASH_KEY_FIXED == hk->type) {
-		hv2 = binary_hash2(key, hk->uk.keysize);
-	} else if (HASH_KEY_ANY_DATA == hk->type || NULL == hk->uh.h.hash2) {
+	if (HASH_KEY_ANY_DATA == hk->type || NULL == hk->uh.h.hash2) {
 		hv2 = UINT32_SWAP(hv) ^ GOLDEN_RATIO_32;
 	} else {
 		hv2 = (*hk->uh.h.hash2)(key);
@@ -766,6 +804,7 @@ hash_resize(struct hash *h, enum hash_resize_mode mode)
 	const void **old_keys, **hk;
 	unsigned *old_hashes, *hp;
 	size_t old_size, old_arena_size, i, keys;
+	bool old_hugepage;
 
 	hash_check(h);
 	assert_hash_locked(h);
@@ -776,6 +815,7 @@ hash_resize(struct hash *h, enum hash_resize_mode mode)
 		old_values = (*h->ops->get_values)(h);
 	old_size = h->kset.size;
 	old_arena_size = hash_arena_size(old_size, h->kset.has_values);
+	old_hugepage = h->kset.hugepage;
 
 	switch (mode) {
 	case HASH_RESIZE_SAME:
@@ -838,7 +878,8 @@ size_computed:
 		"keys=%zu, h->kset.items=%zu, resize mode=%d",
 		keys, h->kset.items, mode);
 
-	hash_arena_size_free(old_keys, old_arena_size, h->kset.raw_memory);
+	hash_arena_size_free(old_keys, old_arena_size,
+		h->kset.raw_memory, old_hugepage);
 	h->kset.relocate = 0;
 }
 
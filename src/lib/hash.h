@@ -97,6 +97,7 @@ struct hkeys {
 	unsigned has_values:1;		/* Whether keys have associated values */
 	unsigned raw_memory:1;		/* Don't use walloc(), use VMM and xpmalloc() */
 	unsigned relocate:10;		/* Attempts for arena relocation */
+	unsigned hugepage:1;		/* Arena advised for huge pages */
 };
 
 #define HASH(x)		((struct hash *) (x))
@@ -139,6 +139,7 @@ struct hash_table {
 	unsigned once:1;			/* Object allocated using "once" memory */
 	unsigned self_keys:1;		/* Keys are self-representing */
 	unsigned fixed_size:1;		/* Table allocated statically */
+	unsigned hugepage:1;		/* Arena advised for huge pages */
 };
 
 /**
@@ -413,8 +414,10 @@ hash_table_new_intern(hash_table_t *ht,
 
 	if G_UNLIKELY(ht->fixed_size) {
 		ht->bins = space;
+		ht->hugepage = FALSE;
 	} else {
 		ht->bins = hash_vmm_alloc(ht, arena);
+		ht->hugepage = booleanize(vmm_madvise_hugepage(ht->bins, arena));
 	}
 
 	g_assert(ht->bins != NULL);
@@ -710,8 +713,11 @@ hash_table_reset(hash_table_t *ht)
 
 	arena = hash_bins_items_arena_size(ht, NULL);
 
+	if (ht->hugepage)
+		vmm_madvise_nohugepage(ht->bins, arena);
 	hash_vmm_free(ht, ht->bins, arena);
 	ht->bins = NULL;
+	ht->hugepage = FALSE;
 	ht->num_bins = 0;
 	ht->items = NULL;
 	ht->num_held = 0;
@@ -792,6 +798,7 @@ hash_table_resize(hash_table_t *ht, size_t n)
 	ht->bin_fill = tmp.bin_fill;
 	ht->bin_bits = tmp.bin_bits;
 	ht->free_list = tmp.free_list;
+	ht->hugepage = tmp.hugepage;
 }
 
 static inline void
@@ -121,6 +121,7 @@ typedef struct {
 #include "plist.h"
 #include "pslist.h"
 #include "stacktrace.h"
+#include "stall.h"
 #include "stringify.h"
 #include "thread.h"			/* For thread_in_syscall_set() */
 #include "tm.h"
@@ -993,7 +994,10 @@ inputevt_handle(const struct poll_ctx *ctx, int fd, inputevt_cond_t condition)
 			continue;
 
 		if (condition & relay->condition) {
+			struct stall_cb sc;
+
 			data_available = 0;		/* FIXME: not thread-safe */
+			stall_cb_enter(&sc, func_to_pointer(relay->handler));
 
 			if G_UNLIKELY(inputevt_trace) {
 				void *handler = relay->handler;
@@ -1008,6 +1012,8 @@ inputevt_handle(const struct poll_ctx *ctx, int fd, inputevt_cond_t condition)
 			} else {
 				relay->handler(relay->data, fd, condition);
 			}
+
+			stall_cb_leave(&sc);
 		}
 	}
 }
@@ -1152,8 +1158,15 @@ poll_func(GPollFD *gfds, unsigned n, int timeout_ms)
 
 	CTX_LOCK(ctx);
 
+	/*
+	 * Collecting events can block for up to the timeout: the main loop is
+	 * then idle and that time must not be accounted to the iteration.
+	 */
+
 	if (0 == ctx->num_ready) {
+		stall_loop_idle();
 		check_for_events(ctx, &timeout_ms);
+		stall_loop_awake();
 	}
 
 	dispatching = ctx->num_ready > 0;
@@ -1166,9 +1179,11 @@ poll_func(GPollFD *gfds, unsigned n, int timeout_ms)
 
 	CTX_LOCK(ctx);
 
+	stall_loop_idle();
 	inputevt_collect_start(ctx, timeout_ms);
 	r = default_poll_func(gfds, n, timeout_ms);
 	inputevt_collect_end(ctx, timeout_ms);
+	stall_loop_awake();
 
 	CTX_UNLOCK(ctx);
 
@@ -1181,6 +1196,24 @@ poll_func(GPollFD *gfds, unsigned n, int timeout_ms)
 	return r;
 }
 
+/**
+ * Poll function used when events are collected through the master fd.
+ *
+ * The kernel event queue is then just another file descriptor for glib, so
+ * all we need is to let the stall detector know when the main loop blocks.
+ */
+static int
+master_poll_func(GPollFD *gfds, unsigned n, int timeout_ms)
+{
+	int r;
+
+	stall_loop_idle();
+	r = default_poll_func(gfds, n, timeout_ms);
+	stall_loop_awake();
+
+	return r;
+}
+
 /**
  * @todo TODO:
  *
@@ -1455,7 +1488,7 @@ init_with_kqueue(struct poll_ctx *ctx)
 
 	g_assert(CTX_IS_LOCKED(ctx));
 
-	g_main_context_set_poll_func(NULL, default_poll_func);
+	g_main_context_set_poll_func(NULL, master_poll_func);
 	ctx->master_fd = fd;
 	ctx->polling_method = "kqueue()";
 	ctx->collect_events = NULL; /* master fd can be polled */
@@ -1485,7 +1518,7 @@ init_with_devpoll(struct poll_ctx *ctx)
 
 	g_assert(CTX_IS_LOCKED(ctx));
 
-	g_main_context_set_poll_func(NULL, default_poll_func);
+	g_main_context_set_poll_func(NULL, master_poll_func);
 	ctx->master_fd = fd;
 	ctx->polling_method = "/dev/poll";
 	ctx->collect_events = collect_events_with_devpoll;
@@ -1515,7 +1548,7 @@ init_with_epoll(struct poll_ctx *ctx)
 
 	g_assert(CTX_IS_LOCKED(ctx));
 
-	g_main_context_set_poll_func(NULL, default_poll_func);
+	g_main_context_set_poll_func(NULL, master_poll_func);
 	ctx->master_fd = fd;
 	ctx->polling_method = "epoll()";
 	ctx->collect_events = NULL; /* master fd can be polled */
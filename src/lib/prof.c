@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2026, Raphael Manfredi
+ *
+ *----------------------------------------------------------------------
+ * This file is part of gtk-gnutella.
+ *
+ *  gtk-gnutella is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gtk-gnutella is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gtk-gnutella; if not, write to the Free Software
+ *  Foundation, Inc.:
+ *      59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *----------------------------------------------------------------------
+ */
+
+/**
+ * @ingroup lib
+ * @file
+ *
+ * Code region profiling.
+ *
+ * A profiled region is a static prof_region_t, declared with PROF_REGION(),
+ * and the code to be measured is bracketed thusly:
+ *
+ *     PROF_REGION(prof_foo, "foo");
+ *     ...
+ *     uint64 start = prof_start();
+ *     ... code being measured ...
+ *     prof_end(&prof_foo, start);
+ *
+ * When profiling is disabled, which is the default, this costs a test of
+ * a global boolean.  When enabled, each measure costs two reads of the
+ * monotonic clock and a few unlocked increments: statistics are kept per
+ * thread, indexed by the small thread ID, so that no two threads ever
+ * write to the same counters.  Readers add up the per-thread figures.
+ *
+ * For each region, we keep the amount of timed executions, the total and
+ * the maximum time spent, and a latency histogram with power-of-two
+ * nanosecond buckets, from which percentiles are estimated.
+ *
+ * @author Raphael Manfredi
+ * @date 2026
+ */
+
+#include "common.h"
+
+#include "prof.h"
+
+#include "atomic.h"
+#include "dump_options.h"
+#include "log.h"
+#include "omalloc.h"
+#include "pow2.h"			/* For highest_bit_set64() */
+#include "spinlock.h"
+#include "str.h"
+#include "stringify.h"
+#include "thread.h"
+#include "tm.h"
+
+#include "override.h"		/* Must be the last header included */
+
+#define PROF_BUCKETS	32	/**< Bucket i counts times in [2^i, 2^(i+1)) ns */
+#define PROF_BILLION	1000000000UL	/**< Nanoseconds per second */
+
+/**
+ * Per-thread statistics for a region.
+ */
+struct prof_stats {
+	uint64 count;				/**< Amount of timed executions */
+	uint64 total;				/**< Total time spent, in ns */
+	uint64 max;					/**< Longest execution, in ns */
+	uint64 hist[PROF_BUCKETS];	/**< Latency histogram */
+};
+
+bool prof_enabled;						/**< Whether profiling is on */
+
+static prof_region_t *prof_regions;		/**< Registered regions */
+static spinlock_t prof_slk = SPINLOCK_INIT;
+
+#define PROF_LOCK		spinlock(&prof_slk)
+#define PROF_UNLOCK		spinunlock(&prof_slk)
+
+/**
+ * @return current monotonic time, in nanoseconds (never 0).
+ */
+uint64
+prof_now(void)
+{
+	uint64 now;
+
+#if defined(HAS_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec tp;
+
+	if G_LIKELY(0 == clock_gettime(CLOCK_MONOTONIC, &tp)) {
+		now = (uint64) tp.tv_sec * PROF_BILLION + tp.tv_nsec;
+	} else
+#endif	/* HAS_CLOCK_GETTIME && CLOCK_MONOTONIC */
+	{
+		tm_nano_t tn;
+
+		tm_precise_time(&tn);
+		now = (uint64) tn.tv_sec * PROF_BILLION + tn.tv_nsec;
+	}
+
+	return MAX(now, 1);
+}
+
+/**
+ * Register region, allocating its per-thread statistics.
+ */
+static void G_COLD
+prof_register(prof_region_t *pr)
+{
+	PROF_LOCK;
+
+	if (NULL == pr->stats) {
+		struct prof_stats *ps;
+
+		OMALLOC0_ARRAY(ps, THREAD_MAX);		/* Never freed */
+		pr->next = prof_regions;
+		prof_regions = pr;
+		atomic_mb();
+		pr->stats = ps;
+	}
+
+	PROF_UNLOCK;
+}
+
+/**
+ * Record the end of a timed execution of a region.
+ *
+ * @param pr		the profiled region
+ * @param start		the value returned by prof_start()
+ */
+void
+prof_record(prof_region_t *pr, uint64 start)
+{
+	struct prof_stats *ps;
+	uint64 d, end;
+	unsigned stid;
+
+	end = prof_now();
+
+	if G_UNLIKELY(NULL == pr->stats)
+		prof_register(pr);
+
+	stid = thread_small_id();
+	if G_UNLIKELY(stid >= THREAD_MAX)
+		return;
+
+	d = end > start ? end - start : 0;
+	ps = &pr->stats[stid];
+
+	ps->count++;
+	ps->total += d;
+	if (d > ps->max)
+		ps->max = d;
+	ps->hist[0 == d ? 0 : MIN(highest_bit_set64(d), PROF_BUCKETS - 1)]++;
+}
+
+/**
+ * Turn profiling on or off.
+ *
+ * Collected statistics are kept when profiling is turned off.
+ */
+void
+prof_enable(bool on)
+{
+	prof_enabled = booleanize(on);
+	atomic_mb();
+}
+
+/**
+ * Clear all the collected statistics.
+ *
+ * Since threads update their counters without locks, executions that end
+ * whilst we are clearing the statistics may or may not be accounted for.
+ */
+void
+prof_reset(void)
+{
+	prof_region_t *pr;
+
+	PROF_LOCK;
+
+	for (pr = prof_regions; pr != NULL; pr = pr->next) {
+		memset(pr->stats, 0, THREAD_MAX * sizeof pr->stats[0]);
+	}
+
+	PROF_UNLOCK;
+}
+
+/**
+ * Add up the per-thread statistics of a region.
+ */
+static void
+prof_collect(const prof_region_t *pr, struct prof_stats *sum)
+{
+	uint i, j;
+
+	ZERO(sum);
+
+	for (i = 0; i < THREAD_MAX; i++) {
+		const struct prof_stats *ps = &pr->stats[i];
+
+		if (0 == ps->count)
+			continue;
+
+		sum->count += ps->count;
+		sum->total += ps->total;
+		sum->max = MAX(sum->max, ps->max);
+		for (j = 0; j < PROF_BUCKETS; j++) {
+			sum->hist[j] += ps->hist[j];
+		}
+	}
+}
+
+/**
+ * Estimate a percentile from the latency histogram.
+ *
+ * @return upper bound of the bucket holding the percentile, in ns.
+ */
+static uint64
+prof_percentile(const struct prof_stats *ps, uint percent)
+{
+	uint64 target, seen = 0;
+	uint i;
+
+	target = (ps->count * percent + 99) / 100;
+
+	for (i = 0; i < PROF_BUCKETS; i++) {
+		seen += ps->hist[i];
+		if (seen >= target)
+			break;
+	}
+
+	return (uint64) 1 << MIN(i + 1, 63);
+}
+
+/**
+ * Format time given in nanoseconds with a suitable unit.
+ *
+ * @return pointer to the start of the supplied buffer.
+ */
+const char *
+prof_time_to_string_buf(uint64 ns, char *buf, size_t len)
+{
+	if (ns < 1000)
+		str_bprintf(buf, len, "%u ns", (uint) ns);
+	else if (ns < 1000 * 1000)
+		str_bprintf(buf, len, "%.2f us", ns / 1e3);
+	else if (ns < 1000 * 1000 * 1000)
+		str_bprintf(buf, len, "%.2f ms", ns / 1e6);
+	else
+		str_bprintf(buf, len, "%.2f s", ns / 1e9);
+
+	return buf;
+}
+
+/**
+ * Dump profiling statistics to specified log agent.
+ *
+ * Unless DUMP_OPT_SHORT is given, a human-readable summary is logged for
+ * each region.  With DUMP_OPT_SHORT, the output is meant to be parsed
+ * by monitoring scripts: one line per region, made of space-separated
+ * "key=value" fields, with the raw histogram given as a comma-separated
+ * list of bucket counts, bucket i counting times in [2^i, 2^(i+1)) ns.
+ */
+void G_COLD
+prof_dump_stats_log(logagent_t *la, unsigned options)
+{
+	bool groupped = booleanize(options & DUMP_OPT_PRETTY);
+	bool raw = booleanize(options & DUMP_OPT_SHORT);
+	prof_region_t *pr, *head;
+	str_t *s = NULL;
+
+	PROF_LOCK;
+	head = prof_regions;		/* Regions are never unregistered */
+	PROF_UNLOCK;
+
+	if (raw) {
+		s = str_new(256);
+	} else {
+		log_info(la, "PROF profiling is %s",
+			prof_enabled ? "enabled" : "disabled");
+	}
+
+	for (pr = head; pr != NULL; pr = pr->next) {
+		struct prof_stats sum;
+
+		prof_collect(pr, &sum);
+
+		if (raw) {
+			uint i;
+
+			str_printf(s, "region=%s count=%s total_ns=%s max_ns=%s hist=",
+				pr->name, uint64_to_string(sum.count),
+				uint64_to_string2(sum.total), uint64_to_string3(sum.max));
+			for (i = 0; i < PROF_BUCKETS; i++) {
+				str_catf(s, "%s%s", 0 == i ? "" : ",",
+					uint64_to_string(sum.hist[i]));
+			}
+			log_info(la, "%s", str_2c(s));
+		} else if (0 == sum.count) {
+			log_info(la, "PROF %s: no calls", pr->name);
+		} else {
+			char avg[32], max[32], p50[32], p99[32];
+
+			prof_time_to_string_buf(sum.total / sum.count, ARYLEN(avg));
+			prof_time_to_string_buf(sum.max, ARYLEN(max));
+			prof_time_to_string_buf(prof_percentile(&sum, 50), ARYLEN(p50));
+			prof_time_to_string_buf(prof_percentile(&sum, 99), ARYLEN(p99));
+
+			log_info(la, "PROF %s: %s call%s, avg %s, max %s, "
+				"p50 < %s, p99 < %s",
+				pr->name, uint64_to_string_grp(sum.count, groupped),
+				plural(sum.count), avg, max, p50, p99);
+		}
+	}
+
+	str_destroy_null(&s);
+}
+
+/* vi: set ts=4 sw=4 cindent: */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026, Raphael Manfredi
+ *
+ *----------------------------------------------------------------------
+ * This file is part of gtk-gnutella.
+ *
+ *  gtk-gnutella is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gtk-gnutella is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gtk-gnutella; if not, write to the Free Software
+ *  Foundation, Inc.:
+ *      59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *----------------------------------------------------------------------
+ */
+
+/**
+ * @ingroup lib
+ * @file
+ *
+ * Code region profiling.
+ *
+ * @author Raphael Manfredi
+ * @date 2026
+ */
+
+#ifndef _prof_h_
+#define _prof_h_
+
+struct prof_stats;
+
+/**
+ * A profiled code region.
+ *
+ * Regions are statically declared with PROF_REGION() and get registered
+ * the first time they are timed whilst profiling is enabled.
+ */
+typedef struct prof_region {
+	const char *name;				/**< Region name, as shown to users */
+	struct prof_stats *stats;		/**< Per-thread statistics */
+	struct prof_region *next;		/**< Next registered region */
+} prof_region_t;
+
+#define PROF_REGION(var, name) \
+	static prof_region_t var = { (name), NULL, NULL }
+
+extern bool prof_enabled;
+
+/*
+ * Public interface.
+ */
+
+struct logagent;
+
+uint64 prof_now(void);
+void prof_record(prof_region_t *pr, uint64 start);
+void prof_enable(bool on);
+void prof_reset(void);
+const char *prof_time_to_string_buf(uint64 ns, char *buf, size_t len);
+void prof_dump_stats_log(struct logagent *la, unsigned options);
+
+/**
+ * Start timing a code region.
+ *
+ * @return the start time to give to prof_end(), 0 if profiling is disabled.
+ */
+static inline ALWAYS_INLINE uint64
+prof_start(void)
+{
+	return G_LIKELY(!prof_enabled) ? 0 : prof_now();
+}
+
+/**
+ * Stop timing a code region started with prof_start().
+ *
+ * @param pr		the profiled region
+ * @param start		the value returned by prof_start()
+ */
+static inline ALWAYS_INLINE void
+prof_end(prof_region_t *pr, uint64 start)
+{
+	if G_UNLIKELY(start != 0)
+		prof_record(pr, start);
+}
+
+#endif /* _prof_h_ */
+
+/* vi: set ts=4 sw=4 cindent: */
@@ -79,35 +79,21 @@ sectoken_lifetime(const sectoken_gen_t *stg)
 }
 
 /**
- * Create a security token from host address and port using specified key.
+ * Fill the 8-byte block identifying the host address and port, which is
+ * then encrypted with one of the keys to produce the security token.
  *
- * Optionally, extra contextual data may be given (i.e. the token is not
- * only based on the address and port) to make the token more unique to
- * a specific context.
+ * The block does not depend on the key, so that validation can compute it
+ * once and try all the keys on it.
  *
- * @param stg		the security token generator
- * @param n			key index to use
- * @param tok		where security token is written
+ * @param block		the block to fill
  * @param addr		address of the host for which we're generating a token
  * @param port		port of the host for which we're generating a token
- * @param data		optional contextual data
- * @param len		length of contextual data
  */
 static void
-sectoken_generate_n(sectoken_gen_t *stg, size_t n,
-	sectoken_t *tok, host_addr_t addr, uint16 port,
-	const void *data, size_t len)
+sectoken_block(char block[8], host_addr_t addr, uint16 port)
 {
-	char block[8];
-	char enc[8];
 	char *p = block;
 
-	sectoken_gen_check(stg);
-	g_assert(tok != NULL);
-	g_assert(size_is_non_negative(n));
-	g_assert(n < stg->keycnt);
-	g_assert((NULL != data) == (len != 0));
-
 	switch (host_addr_net(addr)) {
 	case NET_TYPE_IPV4:
 		p = poke_be32(p, host_addr_ipv4(addr));
@@ -130,11 +116,37 @@ sectoken_generate_n(sectoken_gen_t *stg, size_t n,
 	p = poke_be16(p, 0);		/* Filler */
 
 	g_assert(p == &block[8]);
+}
+
+/**
+ * Create a security token from the host block using specified key.
+ *
+ * Optionally, extra contextual data may be given (i.e. the token is not
+ * only based on the address and port) to make the token more unique to
+ * a specific context.
+ *
+ * @param stg		the security token generator
+ * @param n			key index to use
+ * @param tok		where security token is written
+ * @param hblock	the host block, filled by sectoken_block()
+ * @param data		optional contextual data
+ * @param len		length of contextual data
+ */
+static void
+sectoken_generate_n(sectoken_gen_t *stg, size_t n,
+	sectoken_t *tok, const char hblock[8], const void *data, size_t len)
+{
+	char enc[8];
+
+	sectoken_gen_check(stg);
+	g_assert(tok != NULL);
+	g_assert(size_is_non_negative(n));
+	g_assert(n < stg->keycnt);
+	g_assert((NULL != data) == (len != 0));
 
 	STATIC_ASSERT(sizeof(tok->v) == sizeof(uint32));
-	STATIC_ASSERT(sizeof(block) == sizeof(enc));
 
-	tea_encrypt(&stg->keys[n], enc, ARYLEN(block));
+	tea_encrypt(&stg->keys[n], enc, hblock, 8);
 
 	/*
 	 * If they gave contextual data, encrypt them by block of TEA_BLOCK_SIZE
@@ -144,9 +156,11 @@ sectoken_generate_n(sectoken_gen_t *stg, size_t n,
 	if (data != NULL) {
 		const void *q = data;
 		size_t remain = len;
+		char block[8];
 		char denc[8];
 
 		STATIC_ASSERT(sizeof(denc) == sizeof(enc));
+		STATIC_ASSERT(sizeof(block) == sizeof(enc));
 
 		while (remain != 0) {
 			size_t fill = MIN(remain, TEA_BLOCK_SIZE);
@@ -187,7 +201,10 @@ void
 sectoken_generate(sectoken_gen_t *stg,
 	sectoken_t *tok, host_addr_t addr, uint16 port)
 {
-	sectoken_generate_n(stg, 0, tok, addr, port, NULL, 0);
+	char block[8];
+
+	sectoken_block(block, addr, port);
+	sectoken_generate_n(stg, 0, tok, block, NULL, 0);
 }
 
 /**
@@ -205,10 +222,13 @@ sectoken_generate_with_context(sectoken_gen_t *stg,
 	sectoken_t *tok, host_addr_t addr, uint16 port,
 	const void *data, size_t len)
 {
+	char block[8];
+
 	g_assert(data != NULL);
 	g_assert(size_is_positive(len));
 
-	sectoken_generate_n(stg, 0, tok, addr, port, data, len);
+	sectoken_block(block, addr, port);
+	sectoken_generate_n(stg, 0, tok, block, data, len);
 }
 
 /*
@@ -220,6 +240,7 @@ sectoken_is_valid_internal(sectoken_gen_t *stg,
 	const void *data, size_t len)
 {
 	size_t i;
+	char block[8];
 
 	sectoken_gen_check(stg);
 	g_assert(tok != NULL);
@@ -231,12 +252,15 @@ sectoken_is_valid_internal(sectoken_gen_t *stg,
 	 * generating.
 	 *
 	 * We try the most recent key first as it is the most likely to succeed.
+	 * The host block does not depend on the key, so compute it only once.
 	 */
 
+	sectoken_block(block, addr, port);
+
 	for (i = 0; i < stg->keycnt; i++) {
 		sectoken_t gen;
 
-		sectoken_generate_n(stg, i, &gen, addr, port, data, len);
+		sectoken_generate_n(stg, i, &gen, block, data, len);
 		if (0 == memcmp(&gen, PTRLEN(tok)))
 			return TRUE;
 	}
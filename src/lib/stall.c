@@ -0,0 +1,586 @@
+/*
+ * Copyright (c) 2026, Raphael Manfredi
+ *
+ *----------------------------------------------------------------------
+ * This file is part of gtk-gnutella.
+ *
+ *  gtk-gnutella is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gtk-gnutella is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gtk-gnutella; if not, write to the Free Software
+ *  Foundation, Inc.:
+ *      59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *----------------------------------------------------------------------
+ */
+
+/**
+ * @ingroup lib
+ * @file
+ *
+ * Main event loop stall detection.
+ *
+ * The main event loop flags when it wakes up to process events and when it
+ * is done with them and goes back to waiting.  The time elapsed between
+ * these two points is the latency of the loop iteration: during that time,
+ * no new I/O event can be processed, so it must remain short.
+ *
+ * Callbacks invoked by the I/O layer, the callout queue or the background
+ * task scheduler are also flagged, so that we know which callback is
+ * running and which one ran the longest.
+ *
+ * When enabled, a watchdog thread periodically checks whether the current
+ * loop iteration has lasted more than the configured threshold.  If it has,
+ * the main thread is interrupted to capture its stack, and a stall report
+ * is recorded in a small ring buffer, along with the running callback.
+ * Each stalling iteration is reported at most once.
+ *
+ * All the statistics are updated by the main thread only and therefore
+ * need no locking, except for the report ring which is shared with the
+ * watchdog thread.
+ *
+ * @author Raphael Manfredi
+ * @date 2026
+ */
+
+#include "common.h"
+
+#include "stall.h"
+
+#include "atomic.h"
+#include "cstr.h"
+#include "dump_options.h"
+#include "log.h"
+#include "mutex.h"
+#include "pow2.h"			/* For highest_bit_set64() */
+#include "prof.h"			/* For prof_now() */
+#include "spinlock.h"
+#include "stacktrace.h"
+#include "stringify.h"
+#include "thread.h"
+#include "timestamp.h"
+#include "tm.h"
+
+#include "override.h"		/* Must be the last header included */
+
+#define STALL_THRESHOLD	100		/**< Default threshold, in ms */
+#define STALL_PERIOD	10		/**< Watchdog period, in ms */
+#define STALL_WAIT		100		/**< Max wait for stack sampling, in ms */
+#define STALL_REPORTS	16		/**< Amount of stall reports we keep */
+#define STALL_BUCKETS	32		/**< Bucket i > 0 counts [2^i, 2^(i+1)) us */
+#define STALL_STACK		MAX(THREAD_STACK_MIN, 32768)
+
+#define STALL_MILLION	1000000UL	/**< Nanoseconds per ms */
+
+bool stall_enabled;					/**< Whether detection is on */
+
+/**
+ * State of the main event loop, written by the main thread only.
+ *
+ * The generation number is odd whilst the loop is processing events.
+ */
+static struct stall_loop {
+	uint64 start;					/**< Start of current iteration, ns */
+	const void *fn;					/**< Callback being run, if any */
+	uint gen;						/**< Iteration generation */
+} stall_loop;
+
+/**
+ * Statistics, written by the main thread only.
+ */
+static struct stall_stats {
+	uint64 iterations;				/**< Loop iterations */
+	uint64 total;					/**< Total processing time, ns */
+	uint64 max;						/**< Longest iteration, ns */
+	uint64 stalls;					/**< Iterations over the threshold */
+	uint64 hist[STALL_BUCKETS];		/**< Latency histogram */
+	uint64 cb_max;					/**< Longest callback, ns */
+	const void *cb_max_fn;			/**< Longest callback */
+} stall_stats;
+
+/**
+ * A stall report.
+ */
+struct stall_report {
+	time_t when;					/**< When stall was detected */
+	uint gen;						/**< Stalling iteration */
+	uint64 elapsed;					/**< Iteration time when sampled, ns */
+	uint64 duration;				/**< Iteration total time, 0 if unknown */
+	const void *fn;					/**< Callback running when sampled */
+	const struct stackatom *stack;	/**< Main thread stack, NULL if unknown */
+};
+
+static struct stall_report stall_reports[STALL_REPORTS];
+static uint stall_report_next;		/**< Next slot to use in the ring */
+static uint stall_report_count;		/**< Amount of reports made */
+static spinlock_t stall_report_slk = SPINLOCK_INIT;
+
+#define STALL_REPORT_LOCK		spinlock(&stall_report_slk)
+#define STALL_REPORT_UNLOCK		spinunlock(&stall_report_slk)
+
+/**
+ * Watchdog control.
+ *
+ * The threshold, enabled_at and running fields are only updated under the
+ * mutex.  The threshold and enabled_at are read without locking by the main
+ * thread and the watchdog: seeing a stale value only delays the effect of
+ * stall_enable() by one iteration.
+ *
+ * The sampled_gen field is written by the watchdog and read by the main
+ * thread, the failures field is updated by the watchdog and cleared by
+ * stall_reset(): both are accessed atomically.
+ */
+static struct stall_ctl {
+	uint64 threshold;				/**< Stall threshold, in ns */
+	uint64 enabled_at;				/**< When detection was last enabled */
+	uint sampled_gen;				/**< Last generation sampled */
+	uint failures;					/**< Stack sampling failures */
+	bool running;					/**< Whether watchdog thread runs */
+} stall_ctl = { STALL_THRESHOLD * STALL_MILLION, 0, 0, 0, FALSE };
+
+static mutex_t stall_mtx = MUTEX_INIT;
+
+#define STALL_LOCK		mutex_lock(&stall_mtx)
+#define STALL_UNLOCK	mutex_unlock(&stall_mtx)
+
+/**
+ * Stack sampled in the main thread, filled from an interrupt.
+ */
+static struct stall_sample {
+	struct stacktrace st;
+	bool done;
+} stall_sample;
+
+/**
+ * Enter callback, main thread only.
+ */
+void
+stall_cb_enter_slow(struct stall_cb *sc, const void *fn)
+{
+	if (!thread_is_main()) {
+		sc->start = 0;
+		return;
+	}
+
+	sc->prev = stall_loop.fn;
+	sc->start = prof_now();
+	stall_loop.fn = fn;
+}
+
+/**
+ * Leave callback, recording the longest one.
+ */
+void
+stall_cb_leave_slow(struct stall_cb *sc)
+{
+	uint64 d = prof_now() - sc->start;
+
+	if (d > stall_stats.cb_max) {
+		stall_stats.cb_max = d;
+		stall_stats.cb_max_fn = stall_loop.fn;
+	}
+
+	stall_loop.fn = sc->prev;
+}
+
+/**
+ * Event loop woke up.
+ */
+void
+stall_loop_awake_slow(void)
+{
+	if (!thread_is_main())
+		return;
+
+	stall_loop.start = prof_now();
+	stall_loop.fn = NULL;
+	atomic_mb();
+	stall_loop.gen += (stall_loop.gen & 1) ? 2 : 1;		/* Odd: busy */
+	atomic_mb();
+}
+
+/**
+ * Event loop goes idle, account for the iteration.
+ */
+void
+stall_loop_idle_slow(void)
+{
+	uint64 d, us;
+	uint gen = stall_loop.gen;
+
+	if (0 == (gen & 1) || !thread_is_main())
+		return;
+
+	stall_loop.gen++;		/* Even: idle */
+	atomic_mb();
+
+	d = prof_now() - stall_loop.start;
+
+	stall_stats.iterations++;
+	stall_stats.total += d;
+	if (d > stall_stats.max)
+		stall_stats.max = d;
+	us = d / 1000;
+	stall_stats.hist[
+		0 == us ? 0 : MIN(highest_bit_set64(us), STALL_BUCKETS - 1)]++;
+
+	if (d < stall_ctl.threshold)
+		return;
+
+	stall_stats.stalls++;
+
+	/*
+	 * If the watchdog reported that iteration, record its total duration.
+	 */
+
+	if (gen == atomic_uint_get(&stall_ctl.sampled_gen)) {
+		uint i;
+
+		STALL_REPORT_LOCK;
+		for (i = 0; i < N_ITEMS(stall_reports); i++) {
+			struct stall_report *sr = &stall_reports[i];
+
+			if (gen == sr->gen && sr->when != 0) {
+				sr->duration = d;
+				break;
+			}
+		}
+		STALL_REPORT_UNLOCK;
+	}
+}
+
+/**
+ * Interrupt routine run by the main thread to capture its stack.
+ */
+static void *
+stall_fill_stack(void *arg)
+{
+	struct stall_sample *s = arg;
+
+	s->st.len = stacktrace_unwind(s->st.stack, N_ITEMS(s->st.stack), 2);
+	atomic_mb();
+	s->done = TRUE;
+
+	return NULL;
+}
+
+/**
+ * Capture the stack of the stalling main thread.
+ *
+ * @return the stack atom, NULL if we could not capture it.
+ */
+static const struct stackatom *
+stall_capture_stack(void)
+{
+	struct stall_sample *s = &stall_sample;
+	uint i;
+
+	ZERO(s);
+	atomic_mb();
+
+	if (0 != thread_interrupt(THREAD_MAIN_ID, stall_fill_stack, s, NULL, NULL))
+		goto failed;
+
+	/*
+	 * We sleep via thread_sleep_ms() to process the acknowledgment signal
+	 * the main thread sends back once the interrupt was handled.
+	 */
+
+	for (i = 0; i < STALL_WAIT; i++) {
+		if (s->done)
+			break;
+		thread_sleep_ms(1);
+	}
+
+	atomic_mb();
+
+	if (s->done && s->st.len != 0)
+		return stacktrace_get_atom(&s->st);
+
+	/* FALL THROUGH */
+
+failed:
+	atomic_uint_inc(&stall_ctl.failures);
+	return NULL;
+}
+
+/**
+ * Check whether the main loop is stalling, recording a report if it is.
+ */
+static void
+stall_check(void)
+{
+	struct stall_report sr;
+	uint gen;
+	uint64 start, now;
+	const void *fn;
+
+	/*
+	 * Take a consistent snapshot of the loop state: the generation
+	 * must not change whilst we read the other fields.
+	 */
+
+	gen = stall_loop.gen;
+	atomic_mb();
+	start = stall_loop.start;
+	fn = stall_loop.fn;
+	atomic_mb();
+
+	if (gen != stall_loop.gen || 0 == (gen & 1))
+		return;
+
+	if (
+		gen == atomic_uint_get(&stall_ctl.sampled_gen) ||
+		start < stall_ctl.enabled_at
+	)
+		return;
+
+	now = prof_now();
+
+	if (now < start || now - start < stall_ctl.threshold)
+		return;
+
+	atomic_uint_set(&stall_ctl.sampled_gen, gen);
+
+	ZERO(&sr);
+	sr.when = tm_time();
+	sr.gen = gen;
+	sr.elapsed = now - start;
+	sr.fn = fn;
+	sr.stack = stall_capture_stack();
+
+	STALL_REPORT_LOCK;
+	stall_reports[stall_report_next] = sr;
+	stall_report_next = (stall_report_next + 1) % N_ITEMS(stall_reports);
+	stall_report_count++;
+	STALL_REPORT_UNLOCK;
+}
+
+/**
+ * Watchdog thread.
+ */
+static void *
+stall_watchdog(void *unused_arg)
+{
+	(void) unused_arg;
+
+	thread_set_name("watchdog");
+
+	for (;;) {
+		thread_sleep_ms(STALL_PERIOD);
+
+		STALL_LOCK;
+		if (!stall_enabled) {
+			stall_ctl.running = FALSE;
+			STALL_UNLOCK;
+			break;
+		}
+		STALL_UNLOCK;
+
+		stall_check();
+	}
+
+	return NULL;
+}
+
+/**
+ * Enable stall detection.
+ *
+ * @param threshold_ms	loop iteration latency above which we report a
+ *						stall, in ms, 0 meaning the default threshold.
+ */
+void
+stall_enable(uint threshold_ms)
+{
+	bool start = FALSE;
+
+	if (0 == threshold_ms)
+		threshold_ms = STALL_THRESHOLD;
+
+	STALL_LOCK;
+
+	stall_ctl.threshold = (uint64) threshold_ms * STALL_MILLION;
+	stall_ctl.enabled_at = prof_now();
+
+	if (!stall_ctl.running)
+		start = stall_ctl.running = TRUE;
+
+	stall_enabled = TRUE;
+	atomic_mb();
+
+	STALL_UNLOCK;
+
+	if (start) {
+		int r = thread_create(stall_watchdog, NULL,
+			THREAD_F_DETACH | THREAD_F_NO_POOL | THREAD_F_WARN, STALL_STACK);
+
+		if (-1 == r) {
+			STALL_LOCK;
+			stall_ctl.running = FALSE;
+			stall_enabled = FALSE;
+			STALL_UNLOCK;
+		}
+	}
+}
+
+/**
+ * Disable stall detection, keeping collected statistics and reports.
+ *
+ * The watchdog thread will exit at its next wakeup.
+ */
+void
+stall_disable(void)
+{
+	STALL_LOCK;
+	stall_enabled = FALSE;
+	atomic_mb();
+	STALL_UNLOCK;
+}
+
+/**
+ * Clear the statistics and the stall reports.
+ *
+ * Since the main thread updates its statistics without locks, iterations
+ * that end whilst we are clearing them may or may not be accounted for.
+ */
+void
+stall_reset(void)
+{
+	ZERO(&stall_stats);
+
+	STALL_REPORT_LOCK;
+	ZERO(&stall_reports);
+	stall_report_next = 0;
+	stall_report_count = 0;
+	STALL_REPORT_UNLOCK;
+
+	atomic_uint_set(&stall_ctl.failures, 0);
+}
+
+/**
+ * Fetch the loop iteration counters.
+ *
+ * @param iterations	if non-NULL, filled with the amount of iterations
+ * @param stalls		if non-NULL, filled with the amount of stalls
+ */
+void
+stall_counts(uint64 *iterations, uint64 *stalls)
+{
+	if (iterations != NULL)
+		*iterations = stall_stats.iterations;
+	if (stalls != NULL)
+		*stalls = stall_stats.stalls;
+}
+
+/**
+ * Dump stall detection statistics to specified log agent.
+ */
+void G_COLD
+stall_dump_stats_log(logagent_t *la, unsigned options)
+{
+	bool groupped = booleanize(options & DUMP_OPT_PRETTY);
+	struct stall_stats s = stall_stats;		/* Struct copy */
+	char avg[32], max[32], thr[32];
+	uint i, failures = atomic_uint_get(&stall_ctl.failures);
+
+	prof_time_to_string_buf(stall_ctl.threshold, ARYLEN(thr));
+
+	log_info(la, "STALL detection is %s, threshold %s",
+		stall_enabled ? "enabled" : "disabled", thr);
+
+	if (0 == s.iterations) {
+		log_info(la, "STALL no loop iteration recorded");
+		return;
+	}
+
+	prof_time_to_string_buf(s.total / s.iterations, ARYLEN(avg));
+	prof_time_to_string_buf(s.max, ARYLEN(max));
+
+	log_info(la, "STALL %s iteration%s, avg %s, max %s",
+		uint64_to_string_grp(s.iterations, groupped),
+		plural(s.iterations), avg, max);
+
+	log_info(la, "STALL %s stall%s, %s report%s, %u sampling failure%s",
+		uint64_to_string_grp(s.stalls, groupped), plural(s.stalls),
+		uint_to_string(stall_report_count), plural(stall_report_count),
+		failures, plural(failures));
+
+	if (s.cb_max_fn != NULL) {
+		prof_time_to_string_buf(s.cb_max, ARYLEN(max));
+		log_info(la, "STALL longest callback: %s() for %s",
+			stacktrace_routine_name(s.cb_max_fn, FALSE), max);
+	}
+
+	for (i = 0; i < STALL_BUCKETS; i++) {
+		char lo[32], hi[32];
+
+		if (0 == s.hist[i])
+			continue;
+
+		prof_time_to_string_buf(0 == i ? 0 : (uint64) 1000 << i, ARYLEN(lo));
+		prof_time_to_string_buf((uint64) 1000 << (i + 1), ARYLEN(hi));
+
+		log_info(la, "STALL %10s .. %-10s: %s", lo, hi,
+			uint64_to_string_grp(s.hist[i], groupped));
+	}
+}
+
+/**
+ * Dump recorded stall reports to specified log agent, most recent first.
+ */
+void G_COLD
+stall_dump_reports_log(logagent_t *la, unsigned options)
+{
+	struct stall_report reports[STALL_REPORTS];
+	uint i, next, n = 0;
+
+	(void) options;
+
+	STALL_REPORT_LOCK;
+	STATIC_ASSERT(sizeof reports == sizeof stall_reports);
+	memcpy(reports, stall_reports, sizeof reports);
+	next = stall_report_next;
+	STALL_REPORT_UNLOCK;
+
+	for (i = 0; i < N_ITEMS(reports); i++) {
+		const struct stall_report *sr;
+		char elapsed[32], duration[32];
+
+		sr = &reports[(next + N_ITEMS(reports) - 1 - i) % N_ITEMS(reports)];
+
+		if (0 == sr->when)
+			break;
+
+		n++;
+		prof_time_to_string_buf(sr->elapsed, ARYLEN(elapsed));
+
+		if (0 == sr->duration)
+			cstr_bcpy(ARYLEN(duration), "unknown");
+		else
+			prof_time_to_string_buf(sr->duration, ARYLEN(duration));
+
+		log_info(la, "STALL at %s: busy for %s when sampled, "
+			"lasted %s, in %s%s",
+			timestamp_to_string(sr->when), elapsed, duration,
+			NULL == sr->fn ? "event loop" :
+				stacktrace_routine_name(sr->fn, FALSE),
+			NULL == sr->fn ? "" : "()");
+
+		if (sr->stack != NULL)
+			stacktrace_atom_log(la, sr->stack);
+		else
+			log_info(la, "STALL (no stack captured)");
+	}
+
+	if (0 == n)
+		log_info(la, "STALL no stall reported");
+}
+
+/* vi: set ts=4 sw=4 cindent: */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026, Raphael Manfredi
+ *
+ *----------------------------------------------------------------------
+ * This file is part of gtk-gnutella.
+ *
+ *  gtk-gnutella is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gtk-gnutella is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gtk-gnutella; if not, write to the Free Software
+ *  Foundation, Inc.:
+ *      59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *----------------------------------------------------------------------
+ */
+
+/**
+ * @ingroup lib
+ * @file
+ *
+ * Main event loop stall detection.
+ *
+ * @author Raphael Manfredi
+ * @date 2026
+ */
+
+#ifndef _stall_h_
+#define _stall_h_
+
+/**
+ * Context for a monitored callback invocation, on the caller's stack.
+ */
+struct stall_cb {
+	const void *prev;		/**< Callback being run when we entered */
+	uint64 start;			/**< Start time in ns, 0 if not monitored */
+};
+
+extern bool stall_enabled;
+
+/*
+ * Public interface.
+ */
+
+struct logagent;
+
+void stall_cb_enter_slow(struct stall_cb *sc, const void *fn);
+void stall_cb_leave_slow(struct stall_cb *sc);
+void stall_loop_awake_slow(void);
+void stall_loop_idle_slow(void);
+
+void stall_enable(uint threshold_ms);
+void stall_disable(void);
+void stall_reset(void);
+void stall_counts(uint64 *iterations, uint64 *stalls);
+void stall_dump_stats_log(struct logagent *la, unsigned options);
+void stall_dump_reports_log(struct logagent *la, unsigned options);
+
+/**
+ * Flag entering a callback invoked from the event loop.
+ *
+ * @param sc		the callback context, to be given to stall_cb_leave()
+ * @param fn		the callback being invoked
+ */
+static inline ALWAYS_INLINE void
+stall_cb_enter(struct stall_cb *sc, const void *fn)
+{
+	if G_UNLIKELY(stall_enabled)
+		stall_cb_enter_slow(sc, fn);
+	else
+		sc->start = 0;
+}
+
+/**
+ * Flag that the callback flagged by stall_cb_enter() returned.
+ */
+static inline ALWAYS_INLINE void
+stall_cb_leave(struct stall_cb *sc)
+{
+	if G_UNLIKELY(sc->start != 0)
+		stall_cb_leave_slow(sc);
+}
+
+/**
+ * Flag that the event loop woke up and starts processing events.
+ */
+static inline ALWAYS_INLINE void
+stall_loop_awake(void)
+{
+	if G_UNLIKELY(stall_enabled)
+		stall_loop_awake_slow();
+}
+
+/**
+ * Flag that the event loop is done processing events and will now wait.
+ */
+static inline ALWAYS_INLINE void
+stall_loop_idle(void)
+{
+	if G_UNLIKELY(stall_enabled)
+		stall_loop_idle_slow();
+}
+
+#endif /* _stall_h_ */
+
+/* vi: set ts=4 sw=4 cindent: */
@@ -43,10 +43,12 @@
 #include "crash.h"
 #include "dam.h"
 #include "evq.h"
+#include "fd.h"
 #include "getcpucount.h"
 #include "halloc.h"
 #include "hset.h"
 #include "hstrfn.h"
+#include "inputevt.h"
 #include "log.h"
 #include "misc.h"
 #include "mutex.h"
@@ -62,6 +64,7 @@
 #include "signal.h"
 #include "spinlock.h"
 #include "stacktrace.h"
+#include "stall.h"
 #include "str.h"
 #include "stringify.h"
 #include "strtok.h"
@@ -92,7 +95,7 @@ static void G_NORETURN
 usage(void)
 {
 	fprintf(stderr,
-		"Usage: %s [-hejsvwxABCDEFHIKMNOPQRSUVWX]\n"
+		"Usage: %s [-hejsvwxABCDEFGHIKMNOPQRSUVWX]\n"
 		"       [-a type] [-b size] [-c CPU]\n"
 		"       [-f count] [-n count] [-r percent] [-t ms] [-T msecs]\n"
 		"       [-z fn1,fn2...]\n"
@@ -117,6 +120,7 @@ usage(void)
 		"  -D : test synchronization dams\n"
 		"  -E : test thread signals\n"
 		"  -F : test thread fork\n"
+		"  -G : test stall detection on an idle I/O event loop\n"
 		"  -H : test thread interrupts\n"
 		"  -I : test inter-thread waiter signaling\n"
 		"  -K : test thread cancellation\n"
@@ -2440,6 +2444,76 @@ test_interrupts(void)
 		"interrupt_acks=%d (expected 1)", interrupt_acks);
 }
 
+#define STALL_THRESHOLD_MS	50
+#define STALL_TICK_MS		150
+#define STALL_TICKS			5
+
+static int stall_ticks;
+
+static gboolean
+stall_tick(void *unused_arg)
+{
+	(void) unused_arg;
+
+	stall_ticks++;
+	return TRUE;
+}
+
+static void
+stall_read(void *unused_data, int unused_fd, inputevt_cond_t unused_cond)
+{
+	(void) unused_data;
+	(void) unused_fd;
+	(void) unused_cond;
+
+	s_error("%s(): unexpected I/O event", G_STRFUNC);
+}
+
+static void
+test_stall(void)
+{
+	int fd[2];
+	unsigned id, tag;
+	uint64 iterations, stalls;
+
+	TESTING(G_STRFUNC);
+
+	inputevt_init(TRUE);		/* Force the poll() backend */
+
+	if (-1 == socketpair(AF_UNIX, SOCK_STREAM, 0, fd))
+		s_error("%s(): socketpair() failed: %m", G_STRFUNC);
+
+	/*
+	 * The monitored descriptor never becomes readable, so each iteration
+	 * blocks whilst collecting events until the next tick is due: that
+	 * waiting must not be accounted as processing time.
+	 */
+
+	id = inputevt_add(fd[0], INPUT_EVENT_RX, stall_read, NULL);
+	tag = g_timeout_add(STALL_TICK_MS, stall_tick, NULL);
+
+	stall_enable(STALL_THRESHOLD_MS);
+
+	while (stall_ticks < STALL_TICKS)
+		g_main_context_iteration(NULL, TRUE);
+
+	stall_disable();
+	stall_counts(&iterations, &stalls);
+
+	g_source_remove(tag);
+	inputevt_remove(&id);
+	fd_close(&fd[0]);
+	fd_close(&fd[1]);
+
+	emit("%s(): %s iteration%s, %s stall%s", G_STRFUNC,
+		uint64_to_string(iterations), plural(iterations),
+		uint64_to_string2(stalls), plural(stalls));
+
+	g_assert_log(0 != iterations, "no loop iteration accounted");
+	g_assert_log(0 == stalls,
+		"stalls=%s (expected 0)", uint64_to_string(stalls));
+}
+
 static unsigned
 get_number(const char *arg, int opt)
 {
@@ -2467,9 +2541,9 @@ main(int argc, char **argv)
 	bool inter = FALSE, forking = FALSE, aqueue = FALSE, rwlock = FALSE;
 	bool signals = FALSE, barrier = FALSE, overflow = FALSE, memory = FALSE;
 	bool stats = FALSE, teq = FALSE, cancel = FALSE, dam = FALSE, evq = FALSE;
-	bool interrupts = FALSE, qlock = FALSE;
+	bool interrupts = FALSE, qlock = FALSE, stall = FALSE;
 	unsigned repeat = 1, play_time = 0;
-	const char options[] = "a:b:c:ef:hjn:r:st:vwxz:ABCDEFHIKMNOPQRST:UVWX";
+	const char options[] = "a:b:c:ef:hjn:r:st:vwxz:ABCDEFGHIKMNOPQRST:UVWX";
 
 	progstart(argc, argv);
 	thread_set_main(TRUE);		/* We're the main thread, we can block */
@@ -2495,6 +2569,9 @@ main(int argc, char **argv)
 		case 'F':			/* test thread_fork() */
 			forking = TRUE;
 			break;
+		case 'G':			/* test stall detection on idle loop */
+			stall = TRUE;
+			break;
 		case 'H':			/* test thread interrupts */
 			interrupts = TRUE;
 			break;
@@ -2611,6 +2688,9 @@ main(int argc, char **argv)
 	if (interrupts)
 		test_interrupts();
 
+	if (stall)
+		test_stall();
+
 	if (aqueue)
 		test_aqueue(emulated);
 
@@ -83,6 +83,7 @@
 #include "atomic.h"
 #include "atoms.h"
 #include "barrier.h"
+#include "bit_array.h"
 #include "buf.h"
 #include "compat_gettid.h"
 #include "compat_poll.h"
@@ -2728,6 +2729,7 @@ thread_instantiate(struct thread_element *te, thread_t t)
 	thread_set(te->tid, t);
 	thread_stack_init_shape(te, &te);
 	thread_element_common_init(te, t);
+	te->ptid = pthread_self();			/* For thread_os_kill() */
 	te->system_thread_id = compat_gettid();
 	thread_monitor_exit(te);
 }
@@ -2984,6 +2986,7 @@ thread_main_element(thread_t t)
 
 	threads[0] = te;
 	thread_set(tstid[0], te->tid);
+	te->ptid = pthread_self();			/* For thread_os_kill() */
 	te->system_thread_id = compat_gettid();
 	thread_update_next_stid();
 
@@ -11993,12 +11996,11 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 		uint value[THREAD_MAX];			/* item is the small ID of thread */
 		uint count;						/* amount of outsiders stored */
 	} outsiders;
-	uint64 precursors[THREAD_MAX];		/* value is a bitmask of threads */
+	bit_array_t precursors[THREAD_MAX][BIT_ARRAY_SIZE(THREAD_MAX)];
+	uint npred[THREAD_MAX];				/* amount of precursors of thread */
 	int i;
 	bool deadlock = FALSE;
 
-	STATIC_ASSERT(THREAD_MAX <= 8 * sizeof(uint64));
-
 	THREAD_STATS_INCX(locks_deadlock_checks);
 
 	/*
@@ -12013,6 +12015,7 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 
 	ZERO(&outsiders);
 	ZERO(&precursors);
+	ZERO(&npred);
 
 	spinlock_raw(&thread_deadlock_slk);
 
@@ -12026,15 +12029,18 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 	 *
 	 * Precursors of a thread are stored as a bit in precursors[]. For
 	 * instance, if thread #4 is a predecessor of the current item, then
-	 * its bit #4 is set to 1.  If precursors[i] is 0, then Ti has no
-	 * precursors and is therefore an outsider.
+	 * its bit #4 is set to 1.  The amount of bits set is kept in npred[],
+	 * so that we do not have to scan the bit array: if npred[i] is 0, then
+	 * Ti has no precursors and is therefore an outsider.
+	 *
+	 * Using bit arrays instead of a 64-bit mask lets THREAD_MAX be
+	 * configured beyond 64 threads.
 	 */
 
 	for (i = 0; i < THREAD_MAX; i++) {
 		struct thread_element *te = threads[i];
 		struct thread_lock_stack *tlocks =  &te->locks;
 		struct thread_lock_stack *twaits =  &te->waits;
-		uint64 mask;
 		size_t j;
 
 		if (NULL == te)
@@ -12072,19 +12078,17 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 		 * whether we are indeed deadlocked is not a problem.
 		 */
 
-		mask = 0;
-
 		for (j = 0; j < twaits->count; j++) {
 			struct thread_element *towner;
 
 			towner = thread_lock_owner(twaits->arena[j].lock, NULL);
-			if (towner != NULL)
-				mask |= (uint64) 1U << towner->stid;
+			if (towner != NULL && !bit_array_get(precursors[i], towner->stid)) {
+				bit_array_set(precursors[i], towner->stid);
+				npred[i]++;
+			}
 		}
 
-		precursors[i] = mask;		/* Set of precursors for thread #i */
-
-		if (0 == mask) {
+		if (0 == npred[i]) {
 			g_assert(outsiders.count < N_ITEMS(outsiders.value));
 			outsiders.value[outsiders.count++] = i;
 		}
@@ -12097,13 +12101,14 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 
 	while (outsiders.count != 0) {
 		uint removed = outsiders.value[--outsiders.count];
-		uint64 mask = ~((uint64) 1U << removed);
 
 		for (i = 0; i < THREAD_MAX; i++) {
-			if (0 == precursors[i])
+			if (0 == npred[i])
 				continue;			/* Already an outsider */
-			precursors[i] &= mask;
-			if (0 == precursors[i]) {
+			if (!bit_array_get(precursors[i], removed))
+				continue;
+			bit_array_clear(precursors[i], removed);
+			if (0 == --npred[i]) {
 				/* Becomes a new outsider */
 				g_assert(outsiders.count < N_ITEMS(outsiders.value));
 				outsiders.value[outsiders.count++] = i;
@@ -12113,12 +12118,12 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 
 	/*
 	 * The topological sort is completed.  If there are entries in
-	 * precursors[] with a non-zero value, it means there are cycles
+	 * npred[] with a non-zero value, it means there are cycles
 	 * and therefore we have a deadlock situation!
 	 */
 
 	for (i = 0; i < THREAD_MAX; i++) {
-		if (0 != precursors[i]) {
+		if (0 != npred[i]) {
 			deadlock = TRUE;
 			break;
 		}
@@ -12138,7 +12143,7 @@ thread_deadlock_check(const volatile void *lock, const char *file, uint line)
 	s_miniinfo("dumping lock stack of involved threads:");
 
 	for (i = 0; i < THREAD_MAX; i++) {
-		if (0 != precursors[i])
+		if (0 != npred[i])
 			thread_lock_dump(threads[i]);
 	}
 
@@ -47,7 +47,16 @@ typedef unsigned long thread_t;
 typedef size_t thread_qid_t;		/* Quasi Thread ID */
 typedef unsigned int thread_key_t;	/* Local thread storage key */
 
-#define THREAD_MAX			64		/**< Max amount of threads we can track */
+/**
+ * Max amount of threads we can track.
+ *
+ * This can be raised at build time, but not beyond 255 since qlock and
+ * rwlock record thread small IDs in a byte.
+ */
+#ifndef THREAD_MAX
+#define THREAD_MAX			64
+#endif
+
 #define THREAD_STACK_DFLT	(65536 * PTRSIZE)	/**< Default stack requested */
 #define THREAD_LOCAL_MAX	1024	/**< Max amount of thread-local keys */
 
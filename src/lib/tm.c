@@ -887,6 +887,24 @@ tm_cputime(double *user, double *sys)
 	return u + s;
 }
 
+/**
+ * Get the CPU time used so far by the current thread.
+ *
+ * @return thread CPU time in microseconds, 0 if it cannot be determined.
+ */
+uint64
+tm_thread_cputime(void)
+{
+#if defined(HAS_CLOCK_GETTIME) && defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec tp;
+
+	if G_LIKELY(0 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tp))
+		return (uint64) tp.tv_sec * TM_MILLION + tp.tv_nsec / 1000;
+#endif	/* HAS_CLOCK_GETTIME && CLOCK_THREAD_CPUTIME_ID */
+
+	return 0;
+}
+
 /**
  * Returns the current time relative to the startup time (cached).
  *
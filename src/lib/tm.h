@@ -191,6 +191,7 @@ void tm_current_time(tm_t *tm);
 void tm_precise_time(tm_nano_t *tn);
 bool tm_precise_granularity(tm_nano_t *tn);
 double tm_cputime(double *user, double *sys);
+uint64 tm_thread_cputime(void);
 
 uint tm_hash(const void *key) G_PURE;
 int tm_equal(const void *a, const void *b) G_PURE;
@@ -193,6 +193,7 @@ static int vmm_oom_detected;
 #define VMM_FOREIGN_MAXLEN	(512 * 1024)	/**< 512 KiB */
 #define VMM_WARN_THRESH		512	/**< Pages, 2 MiB with 4K pages */
 #define VMM_MOVE_THRESH		16	/**< Pages, user threshold if within region! */
+#define VMM_HUGEPAGE_SIZE	(2 * 1024 * 1024)	/**< 2 MiB, x86 huge pages */
 
 #define PMAP_FOREIGN_TRY	512	/**< Amount of foreign pages we try to allocate */
 
@@ -339,6 +340,10 @@ static struct vmm_stats {
 	uint64 pmap_foreign_discarded_pages;	/**< Foreign pages discarded */
 	AU64(pmap_overruled);			/**< Regions overruled by kernel */
 	AU64(pmap_dropped);				/**< Dropped regions while extending pmap */
+	AU64(hugepage_advised);			/**< Regions advised for huge pages */
+	AU64(hugepage_advised_pages);	/**< Huge-page aligned pages advised */
+	AU64(hugepage_refused);			/**< Huge page advice refused by kernel */
+	AU64(hugepage_revoked);			/**< Huge page advice revoked */
 	uint64 hole_reused;				/**< Amount of times we use cached hole */
 	uint64 hole_invalidated;		/**< Times we invalidate cached hole */
 	uint64 hole_updated;			/**< Times we updated the cached hole */
@@ -361,6 +366,7 @@ static spinlock_t vmm_stats_slk = SPINLOCK_INIT;
 #define VMM_STATS_IS_LOCKED	spinlock_is_held(&vmm_stats_slk)
 
 #define VMM_STATS_INCX(x)	AU64_INC(&vmm_stats.x)
+#define VMM_STATS_ADDX(x,n)	AU64_ADD(&vmm_stats.x, n)
 
 /**
  * The local version of the process memory map.
@@ -2798,11 +2804,12 @@ page_cache_return_pages(void *p, size_t n)
  * @param base		start of the region
  * @param len		length of the region in bytes
  * @param user_mem	TRUE if moving a user region, as opposed to a core one
+ * @param hugepage	if non-NULL, region advised for huge pages
  *
  * @return new pointer for the region (may be `base' still if not moved).
  */
 static void *
-vmm_move_internal(void *base, size_t len, bool user_mem)
+vmm_move_internal(void *base, size_t len, bool user_mem, bool *hugepage)
 {
 	struct pmap *pm;
 	size_t size;
@@ -3003,8 +3010,20 @@ success:
 	}
 	VMM_STATS_UNLOCK;
 
+	/*
+	 * When the old region was advised for huge pages, advise the new one
+	 * before copying so that it can be faulted-in with huge pages, and
+	 * revoke the advice on the old one before it is recycled.
+	 */
+
+	if (hugepage != NULL)
+		*hugepage = vmm_madvise_hugepage(p, len);
+
 	memcpy(p, base, len);		/* Not `size': skip possible unused tail */
 
+	if (hugepage != NULL)
+		vmm_madvise_nohugepage(base, len);
+
 	/*
 	 * Note that we do NOT call vmm_free() for user regions, to be able to
 	 * completely bypass the magazines when freeing the old region: we do not
@@ -3056,7 +3075,7 @@ failed:
 void *
 vmm_move(void *base, size_t len)
 {
-	return vmm_move_internal(base, len, TRUE);
+	return vmm_move_internal(base, len, TRUE, NULL);
 }
 
 /**
@@ -3070,7 +3089,29 @@ vmm_move(void *base, size_t len)
 void *
 vmm_core_move(void *base, size_t len)
 {
-	return vmm_move_internal(base, len, FALSE);
+	return vmm_move_internal(base, len, FALSE, NULL);
+}
+
+/**
+ * Attempt to move the user region, advised for huge pages, to a better
+ * location in the VM space.
+ *
+ * When the region is moved, the advice is revoked on the old region before
+ * it is freed and given to the new region.  Nothing is done to the advice
+ * when the region stays where it is.
+ *
+ * @param base		start of the region
+ * @param len		length of the region in bytes
+ * @param advised	if moved, set to whether the new region could be advised
+ *
+ * @return new pointer for the region (may be `base' still if not moved).
+ */
+void *
+vmm_move_hugepage(void *base, size_t len, bool *advised)
+{
+	g_assert(advised != NULL);
+
+	return vmm_move_internal(base, len, TRUE, advised);
 }
 
 /**
@@ -4498,6 +4539,103 @@ vmm_madvise_willneed(void *p, size_t size)
 #endif	/* MADV_WILLNEED */
 }
 
+#if defined(HAS_MADVISE) && defined(MADV_HUGEPAGE)
+/**
+ * Restrict region to the part that is aligned on huge page boundaries.
+ *
+ * @param p		the start of the region, updated to the first huge page
+ * @param size	the size of the region, updated to the huge-page aligned size
+ *
+ * @return TRUE if the region spans at least one full huge page.
+ */
+static bool
+vmm_hugepage_range(void **p, size_t *size)
+{
+	ulong start, end;
+
+	if (*size < VMM_HUGEPAGE_SIZE)
+		return FALSE;
+
+	start = pointer_to_ulong(*p);
+	end = start + *size;
+	start = (start + VMM_HUGEPAGE_SIZE - 1) & ~(VMM_HUGEPAGE_SIZE - 1);
+	end &= ~(VMM_HUGEPAGE_SIZE - 1);
+
+	if (end <= start)
+		return FALSE;
+
+	*p = ulong_to_pointer(start);
+	*size = end - start;
+
+	return TRUE;
+}
+#endif	/* MADV_HUGEPAGE */
+
+/**
+ * Advise the kernel that the region is a good candidate for being backed
+ * by huge pages.
+ *
+ * This is meant for large, long-lived and randomly accessed regions, such
+ * as big hash tables, where the TLB misses caused by small pages become
+ * noticeable.  Only the part of the region that is aligned on a huge page
+ * boundary is advised: regions not spanning a full huge page are left alone.
+ *
+ * The advice sticks to the pages, not to the allocation: a region freed to
+ * the VMM layer would be recycled through the page cache with it.  Callers
+ * must therefore remember whether the advice was taken and, if it was, invoke
+ * vmm_madvise_nohugepage() on the region before it is freed, or move it with
+ * vmm_move_hugepage().
+ *
+ * @param p		the start of the region
+ * @param size	the size of the region
+ *
+ * @return TRUE if the advice was given on (part of) the region.
+ */
+bool
+vmm_madvise_hugepage(void *p, size_t size)
+{
+	g_assert(p);
+	g_assert(size_is_positive(size));
+#if defined(HAS_MADVISE) && defined(MADV_HUGEPAGE)
+	if (!vmm_hugepage_range(&p, &size))
+		return FALSE;
+
+	if (-1 == madvise(p, size, MADV_HUGEPAGE)) {
+		VMM_STATS_INCX(hugepage_refused);
+		return FALSE;
+	}
+
+	VMM_STATS_INCX(hugepage_advised);
+	VMM_STATS_ADDX(hugepage_advised_pages, vmm_page_count(size));
+	return TRUE;
+#else
+	return FALSE;
+#endif	/* MADV_HUGEPAGE */
+}
+
+/**
+ * Revoke the advice given by vmm_madvise_hugepage() on the region.
+ *
+ * This must be called before the region is released to the VMM layer, so
+ * that recycled pages do not keep being backed by huge pages.
+ *
+ * @param p		the start of the region
+ * @param size	the size of the region
+ */
+void
+vmm_madvise_nohugepage(void *p, size_t size)
+{
+	g_assert(p);
+	g_assert(size_is_positive(size));
+#if defined(HAS_MADVISE) && defined(MADV_NOHUGEPAGE)
+	if (!vmm_hugepage_range(&p, &size))
+		return;
+
+	if (0 == madvise(p, size, MADV_NOHUGEPAGE))
+		VMM_STATS_INCX(hugepage_revoked);
+#endif	/* MADV_NOHUGEPAGE */
+}
+
 /**
  * Perform memory allocation during crashes.
  *
@@ -5929,6 +6067,10 @@ vmm_dump_stats_log(logagent_t *la, unsigned options)
 	DUMP(pmap_foreign_discarded_pages);
 	DUMP64(pmap_overruled);
 	DUMP64(pmap_dropped);
+	DUMP64(hugepage_advised);
+	DUMP64(hugepage_advised_pages);
+	DUMP64(hugepage_refused);
+	DUMP64(hugepage_revoked);
 
 	/*
 	 * These variables are not updated with the VMM stats lock but whith
@@ -137,6 +137,7 @@ bool vmm_is_stack_pointer(const void *p, const void *top) G_PURE;
 bool vmm_grows_upwards(void) G_PURE;
 void *vmm_move(void *base, size_t size);
 void *vmm_core_move(void *base, size_t size);
+void *vmm_move_hugepage(void *base, size_t size, bool *advised);
 
 void set_vmm_debug(uint32 level);
 bool vmm_is_debugging(uint32 level) G_PURE;
@@ -167,6 +168,8 @@ void vmm_madvise_free(void *p, size_t size);
 void vmm_madvise_normal(void *p, size_t size);
 void vmm_madvise_sequential(void *p, size_t size);
 void vmm_madvise_willneed(void *p, size_t size);
+bool vmm_madvise_hugepage(void *p, size_t size);
+void vmm_madvise_nohugepage(void *p, size_t size);
 
 void *vmm_mmap(void *addr, size_t length,
 	int prot, int flags, int fd, fileoffset_t offset);
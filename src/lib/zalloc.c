@@ -337,12 +337,16 @@ static leak_set_t *z_leakset;
  * Internal statistics collected.
  *
  * The AU64() fields are atomically updated (without taking the stats lock).
+ * So are the user_memory and user_blocks fields: they are updated on each
+ * zalloc() and zfree(), and funneling all the threads through a single
+ * global lock there would make the statistics the main contention point
+ * of the allocator, whatever the zone being used.
  */
 static struct zstats {
-	uint64 allocations;				/**< Total amount of allocations */
-	uint64 freeings;				/**< Total amount of freeings */
-	uint64 freeings_list;			/**< Total amount of freeings via list */
-	uint64 freeings_list_blocks;	/**< Amount of blocks freed via list */
+	AU64(allocations);				/**< Total amount of allocations */
+	AU64(freeings);					/**< Total amount of freeings */
+	AU64(freeings_list);			/**< Total amount of freeings via list */
+	AU64(freeings_list_blocks);		/**< Amount of blocks freed via list */
 	AU64(allocations_gc);			/**< Subset of allocations in GC mode */
 	AU64(freeings_gc);				/**< Subset of freeings in GC mode */
 	uint64 subzones_allocated;		/**< Total amount of subzone creations */
@@ -365,8 +369,8 @@ static struct zstats {
 	AU64(zgc_scan_freed);			/**< Zones freed during zgc_scan() */
 	uint64 zgc_excess_zones_freed;	/**< Zones freed during zn_shrink() */
 	uint64 zgc_shrinked;			/**< Amount of zn_shrink() calls */
-	size_t user_memory;				/**< Current user memory allocated */
-	size_t user_blocks;				/**< Current amount of user blocks */
+	size_t user_memory;				/**< Current user memory (atomic) */
+	size_t user_blocks;				/**< Current user blocks (atomic) */
 	/* Counter to prevent digest from being the same twice in a row */
 	AU64(zalloc_stats_digest);
 } zstats;
@@ -376,6 +380,7 @@ static spinlock_t zstats_slk = SPINLOCK_INIT;
 #define ZSTATS_UNLOCK		spinunlock_hidden(&zstats_slk)
 
 #define ZSTATS_INCX(x)		AU64_INC(&zstats.x)
+#define ZSTATS_ADDX(x,n)	AU64_ADD(&zstats.x, n)
 
 /**
  * @return (physical) block size for a given zone.
@@ -853,11 +858,9 @@ zalloc(zone_t *zone)
 
 	/* NB: this routine must be as fast as possible. No assertions */
 
-	ZSTATS_LOCK;
-	zstats.allocations++;
-	zstats.user_blocks++;
-	zstats.user_memory += zone->zn_size;
-	ZSTATS_UNLOCK;
+	ZSTATS_INCX(allocations);
+	ATOMIC_INC(&zstats.user_blocks);
+	ATOMIC_ADD(&zstats.user_memory, zone->zn_size);
 	memusage_add_one(zone->zn_mem);
 
 	/*
@@ -1221,11 +1224,9 @@ zfree(zone_t *zone, void *ptr)
 	zreturn(zone, ptr);
 	zunlock(zone);
 
-	ZSTATS_LOCK;
-	zstats.freeings++;
-	zstats.user_blocks--;
-	zstats.user_memory -= zone->zn_size;
-	ZSTATS_UNLOCK;
+	ZSTATS_INCX(freeings);
+	ATOMIC_DEC(&zstats.user_blocks);
+	ATOMIC_SUB(&zstats.user_memory, zone->zn_size);
 	memusage_remove_one(zone->zn_mem);
 }
 
@@ -1250,13 +1251,11 @@ zfree_pslist(zone_t *zone, pslist_t *pl)
 
 	zunlock(zone);
 
-	ZSTATS_LOCK;
-	zstats.freeings +=n;
-	zstats.freeings_list++;
-	zstats.freeings_list_blocks +=n;
-	zstats.user_blocks -= n;
-	zstats.user_memory -= zone->zn_size * n;
-	ZSTATS_UNLOCK;
+	ZSTATS_ADDX(freeings, n);
+	ZSTATS_INCX(freeings_list);
+	ZSTATS_ADDX(freeings_list_blocks, n);
+	ATOMIC_SUB(&zstats.user_blocks, n);
+	ATOMIC_SUB(&zstats.user_memory, zone->zn_size * n);
 
 	memusage_remove_multiple(zone->zn_mem, n);
 }
@@ -1284,13 +1283,11 @@ zfree_eslist(zone_t *zone, eslist_t *el)
 
 	g_assert(n == eslist_count(el));
 
-	ZSTATS_LOCK;
-	zstats.freeings +=n;
-	zstats.freeings_list++;
-	zstats.freeings_list_blocks +=n;
-	zstats.user_blocks -= n;
-	zstats.user_memory -= zone->zn_size * n;
-	ZSTATS_UNLOCK;
+	ZSTATS_ADDX(freeings, n);
+	ZSTATS_INCX(freeings_list);
+	ZSTATS_ADDX(freeings_list_blocks, n);
+	ATOMIC_SUB(&zstats.user_blocks, n);
+	ATOMIC_SUB(&zstats.user_memory, zone->zn_size * n);
 
 	memusage_remove_multiple(zone->zn_mem, n);
 }
@@ -3859,10 +3856,10 @@ zalloc_dump_stats_log(logagent_t *la, unsigned options)
 		uint64_to_string_grp(v, groupped));					\
 } G_STMT_END
 
-	DUMP(allocations);
-	DUMP(freeings);
-	DUMP(freeings_list);
-	DUMP(freeings_list_blocks);
+	DUMP64(allocations);
+	DUMP64(freeings);
+	DUMP64(freeings_list);
+	DUMP64(freeings_list_blocks);
 	DUMP64(allocations_gc);
 	DUMP64(freeings_gc);
 	DUMP(subzones_allocated);
@@ -31,6 +31,7 @@
 #include "lib/stringify.h"		/* For plural() */
 #include "lib/vmm.h"
 #include "lib/walloc.h"
+#include "lib/xsort.h"
 
 #include "lib/override.h"		/* Must be the last header included */
 
@@ -272,10 +273,25 @@ init_cache(DBM *db, uint pages, bool wdelay)
  */
 void lru_init(DBM *db)
 {
+	uint pages;
+
 	g_assert(NULL == db->cache);
 	g_assert(-1 == db->pagbno);		/* We must be called before first access */
 
-	init_cache(db, LRU_PAGES, FALSE);
+	/*
+	 * A read-only database can use a much larger cache: cached pages are
+	 * only allocated as they are read, so the cache never grows past the
+	 * size of the .pag file, and once all the pages are loaded lookups
+	 * are served from memory without any further I/O or evictions.
+	 *
+	 * This only matters to the offline tools (dbt, dba, dbd...) since the
+	 * application never opens a database read-only: its databases are
+	 * opened read-write and size their cache via dbmw_set_map_cache().
+	 */
+
+	pages = (db->flags & DBM_RDONLY) ? LRU_RDONLY_PAGES : LRU_PAGES;
+
+	init_cache(db, pages, FALSE);
 }
 
 static void
@@ -382,9 +398,24 @@ flush_cpage(struct lru_cpage *cp, ssize_t *amount, int *error)
 	return TRUE;	/* Everything OK, page was clean */
 }
 
+/**
+ * xsort() callback to order cached pages by increasing page number.
+ */
+static int
+lru_cpage_numpag_cmp(const void *a, const void *b)
+{
+	const struct lru_cpage * const *ca = a, * const *cb = b;
+
+	return CMP((*ca)->numpag, (*cb)->numpag);
+}
+
 /**
  * Flush all the dirty pages to disk.
  *
+ * Dirty pages are written by increasing page number rather than in LRU
+ * order, so that a sync after a burst of updates turns into a mostly
+ * sequential sweep of the .pag file instead of random writes.
+ *
  * @return the amount of pages successfully flushed as a positive number
  * if everything was fine, 0 if there was nothing to flush, and -1 if there
  * were I/O errors (errno is set).
@@ -393,7 +424,8 @@ ssize_t
 flush_dirtypag(const DBM *db)
 {
 	const struct lru_cache *cache = db->cache;
-	struct lru_cpage *cp;
+	struct lru_cpage *cp, **dirty;
+	size_t i, n = 0;
 	ssize_t amount = 0;
 	int saved_errno = 0;
 
@@ -405,18 +437,43 @@ flush_dirtypag(const DBM *db)
 
 	ELIST_FOREACH_DATA(&cache->lru, cp) {
 		sdbm_lru_cpage_valid(cp, db);
-		if (!flush_cpage(cp, &amount, &saved_errno))
-			break;
+		if (cp->dirty)
+			n++;
 	}
 
-	if (saved_errno != 0) {
-		ELIST_FOREACH_DATA(&cache->wired, cp) {
-			sdbm_lru_cpage_valid(cp, db);
-			if (!flush_cpage(cp, &amount, &saved_errno))
-				break;
-		}
+	ELIST_FOREACH_DATA(&cache->wired, cp) {
+		sdbm_lru_cpage_valid(cp, db);
+		if (cp->dirty)
+			n++;
+	}
+
+	if (0 == n)
+		return 0;
+
+	WALLOC_ARRAY(dirty, n);
+	i = 0;
+
+	ELIST_FOREACH_DATA(&cache->lru, cp) {
+		if (cp->dirty)
+			dirty[i++] = cp;
 	}
 
+	ELIST_FOREACH_DATA(&cache->wired, cp) {
+		if (cp->dirty)
+			dirty[i++] = cp;
+	}
+
+	g_assert(i == n);
+
+	xsort(dirty, n, sizeof dirty[0], lru_cpage_numpag_cmp);
+
+	for (i = 0; i < n; i++) {
+		if (!flush_cpage(dirty[i], &amount, &saved_errno))
+			break;
+	}
+
+	WFREE_ARRAY(dirty, n);
+
 	if (saved_errno != 0) {
 		errno = saved_errno;
 		return -1;
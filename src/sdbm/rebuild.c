@@ -91,8 +91,18 @@ sdbm_attr_propagate(DBM *ndb, const DBM *db)
 	cache = sdbm_get_cache(db);
 
 	if (sdbm_is_volatile(db))	sdbm_set_volatile(ndb, TRUE);
-	if (sdbm_get_wdelay(db))	sdbm_set_wdelay(ndb, TRUE);
-	if (cache != 0)				sdbm_set_cache(ndb, cache);
+
+	/*
+	 * The page cache of the new database is only used whilst we copy data
+	 * into it: sdbm_replace_descriptor() will keep the cache of the old
+	 * database.  Therefore, we can always defer writes and use a large cache
+	 * during the copy, so that the pages are written once, in order, when
+	 * the new database is synced, instead of being rewritten at each split
+	 * or eviction, which is what made large rebuilds so slow.
+	 */
+
+	sdbm_set_wdelay(ndb, TRUE);
+	sdbm_set_cache(ndb, MAX(cache, LRU_REBUILD_PAGES));
 }
 
 /**
@@ -13,6 +13,8 @@
 #define SEEDUPS			/* always detect duplicates */
 #define LRU				/* use LRU cache for pages */
 #define LRU_PAGES	64	/* default amount of pages in LRU cache */
+#define LRU_RDONLY_PAGES	1024	/* LRU cache size when read-only (tools) */
+#define LRU_REBUILD_PAGES	1024	/* LRU cache size of DB being rebuilt */
 #define BIGDATA			/* can store large keys/values */
 #define THREADS			/* thread-safe */
 
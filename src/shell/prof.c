@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026, Raphael Manfredi
+ *
+ *----------------------------------------------------------------------
+ * This file is part of gtk-gnutella.
+ *
+ *  gtk-gnutella is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gtk-gnutella is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gtk-gnutella; if not, write to the Free Software
+ *  Foundation, Inc.:
+ *      59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *----------------------------------------------------------------------
+ */
+
+/**
+ * @ingroup shell
+ * @file
+ *
+ * The "prof" command.
+ *
+ * @author Raphael Manfredi
+ * @date 2026
+ */
+
+#include "common.h"
+
+#include "cmd.h"
+
+#include "lib/ascii.h"
+#include "lib/dump_options.h"
+#include "lib/log.h"
+#include "lib/options.h"
+#include "lib/prof.h"
+
+#include "lib/override.h"		/* Must be the last header included */
+
+static enum shell_reply
+shell_exec_prof_show(struct gnutella_shell *sh,
+	int argc, const char *argv[], bool raw)
+{
+	const char *pretty;
+	const option_t options[] = {
+		{ "p", &pretty },			/* pretty-print */
+	};
+	int parsed;
+	unsigned opt = 0;
+	logagent_t *la = log_agent_string_make(0, "PROF ");
+
+	shell_check(sh);
+
+	parsed = shell_options_parse(sh, argv, options, N_ITEMS(options));
+	if (parsed < 0)
+		goto failure;
+
+	argv += parsed;		/* args[0] is first command argument */
+	argc -= parsed;		/* counts only command arguments now */
+
+	if (0 != argc)
+		goto failure;
+
+	if (pretty != NULL && !raw)
+		opt |= DUMP_OPT_PRETTY;
+	if (raw)
+		opt |= DUMP_OPT_SHORT;
+
+	prof_dump_stats_log(la, opt);
+
+	shell_write(sh, "100~\n");
+	shell_write(sh, log_agent_string_get(la));
+	shell_write(sh, ".\n");
+
+	log_agent_free_null(&la);
+
+	return REPLY_READY;
+
+failure:
+	log_agent_free_null(&la);
+	return REPLY_ERROR;
+}
+
+/**
+ * Handles the prof command.
+ */
+enum shell_reply
+shell_exec_prof(struct gnutella_shell *sh, int argc, const char *argv[])
+{
+	shell_check(sh);
+	g_assert(argv);
+	g_assert(argc > 0);
+
+	if (argc < 2)
+		return REPLY_ERROR;
+
+	if (0 == ascii_strcasecmp(argv[1], "on")) {
+		prof_enable(TRUE);
+		shell_write(sh, "Profiling enabled\n");
+		return REPLY_READY;
+	} else if (0 == ascii_strcasecmp(argv[1], "off")) {
+		prof_enable(FALSE);
+		shell_write(sh, "Profiling disabled\n");
+		return REPLY_READY;
+	} else if (0 == ascii_strcasecmp(argv[1], "reset")) {
+		prof_reset();
+		shell_write(sh, "Profiling statistics cleared\n");
+		return REPLY_READY;
+	} else if (0 == ascii_strcasecmp(argv[1], "show")) {
+		return shell_exec_prof_show(sh, argc - 1, argv + 1, FALSE);
+	} else if (0 == ascii_strcasecmp(argv[1], "raw")) {
+		return shell_exec_prof_show(sh, argc - 1, argv + 1, TRUE);
+	}
+
+	shell_set_formatted(sh, _("Unknown operation \"%s\""), argv[1]);
+	return REPLY_ERROR;
+}
+
+const char *
+shell_summary_prof(void)
+{
+	return "Code profiling interface";
+}
+
+const char *
+shell_help_prof(int argc, const char *argv[])
+{
+	g_assert(argv);
+	g_assert(argc > 0);
+
+	if (argc > 1) {
+		if (0 == ascii_strcasecmp(argv[1], "show")) {
+			return "prof show [-p]\n"
+				"show timing statistics of profiled code regions\n"
+				"-p : pretty-print numbers with thousands separators\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "raw")) {
+			return "prof raw\n"
+				"dump statistics in a machine-readable format, one line\n"
+				"per region with space-separated key=value fields; the\n"
+				"\"hist\" field lists the amount of calls lasting between\n"
+				"2^i and 2^(i+1) nanoseconds, for i = 0 to 31\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "on")) {
+			return "prof on\n"
+				"enable timing of profiled code regions\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "off")) {
+			return "prof off\n"
+				"disable timing, keeping collected statistics\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "reset")) {
+			return "prof reset\n"
+				"clear collected statistics\n";
+		}
+	} else {
+		return
+			"prof on|off\n"
+			"prof reset\n"
+			"prof show [-p]\n"
+			"prof raw\n"
+			;
+	}
+	return NULL;
+}
+
+/* vi: set ts=4 sw=4 cindent: */
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2026, Raphael Manfredi
+ *
+ *----------------------------------------------------------------------
+ * This file is part of gtk-gnutella.
+ *
+ *  gtk-gnutella is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gtk-gnutella is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gtk-gnutella; if not, write to the Free Software
+ *  Foundation, Inc.:
+ *      59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *----------------------------------------------------------------------
+ */
+
+/**
+ * @ingroup shell
+ * @file
+ *
+ * The "stall" command.
+ *
+ * @author Raphael Manfredi
+ * @date 2026
+ */
+
+#include "common.h"
+
+#include "cmd.h"
+
+#include "lib/ascii.h"
+#include "lib/dump_options.h"
+#include "lib/log.h"
+#include "lib/options.h"
+#include "lib/parse.h"
+#include "lib/stall.h"
+
+#include "lib/override.h"		/* Must be the last header included */
+
+typedef void (*shell_stall_dump_t)(struct logagent *la, unsigned options);
+
+static enum shell_reply
+shell_exec_stall_dump(struct gnutella_shell *sh,
+	int argc, const char *argv[], shell_stall_dump_t dump)
+{
+	const char *pretty;
+	const option_t options[] = {
+		{ "p", &pretty },			/* pretty-print */
+	};
+	int parsed;
+	unsigned opt = 0;
+	logagent_t *la = log_agent_string_make(0, "STALL ");
+
+	shell_check(sh);
+
+	parsed = shell_options_parse(sh, argv, options, N_ITEMS(options));
+	if (parsed < 0)
+		goto failure;
+
+	argv += parsed;		/* args[0] is first command argument */
+	argc -= parsed;		/* counts only command arguments now */
+
+	if (0 != argc)
+		goto failure;
+
+	if (pretty != NULL)
+		opt |= DUMP_OPT_PRETTY;
+
+	(*dump)(la, opt);
+
+	shell_write(sh, "100~\n");
+	shell_write(sh, log_agent_string_get(la));
+	shell_write(sh, ".\n");
+
+	log_agent_free_null(&la);
+
+	return REPLY_READY;
+
+failure:
+	log_agent_free_null(&la);
+	return REPLY_ERROR;
+}
+
+/**
+ * Handles the stall command.
+ */
+enum shell_reply
+shell_exec_stall(struct gnutella_shell *sh, int argc, const char *argv[])
+{
+	shell_check(sh);
+	g_assert(argv);
+	g_assert(argc > 0);
+
+	if (argc < 2)
+		return REPLY_ERROR;
+
+	if (0 == ascii_strcasecmp(argv[1], "on")) {
+		uint32 ms = 0;
+
+		if (argc > 2) {
+			int error;
+
+			ms = parse_uint32(argv[2], NULL, 10, &error);
+			if (error != 0 || 0 == ms) {
+				shell_set_formatted(sh, _("Invalid threshold \"%s\""),
+					argv[2]);
+				return REPLY_ERROR;
+			}
+		}
+
+		stall_enable(ms);
+		shell_write(sh, "Stall detection enabled\n");
+		return REPLY_READY;
+	} else if (0 == ascii_strcasecmp(argv[1], "off")) {
+		stall_disable();
+		shell_write(sh, "Stall detection disabled\n");
+		return REPLY_READY;
+	} else if (0 == ascii_strcasecmp(argv[1], "reset")) {
+		stall_reset();
+		shell_write(sh, "Stall statistics and reports cleared\n");
+		return REPLY_READY;
+	} else if (0 == ascii_strcasecmp(argv[1], "show")) {
+		return shell_exec_stall_dump(sh, argc - 1, argv + 1,
+			stall_dump_stats_log);
+	} else if (0 == ascii_strcasecmp(argv[1], "reports")) {
+		return shell_exec_stall_dump(sh, argc - 1, argv + 1,
+			stall_dump_reports_log);
+	}
+
+	shell_set_formatted(sh, _("Unknown operation \"%s\""), argv[1]);
+	return REPLY_ERROR;
+}
+
+const char *
+shell_summary_stall(void)
+{
+	return "Event loop stall detection";
+}
+
+const char *
+shell_help_stall(int argc, const char *argv[])
+{
+	g_assert(argv);
+	g_assert(argc > 0);
+
+	if (argc > 1) {
+		if (0 == ascii_strcasecmp(argv[1], "on")) {
+			return "stall on [ms]\n"
+				"enable stall detection: a watchdog thread captures the\n"
+				"stack of the main thread when an event loop iteration\n"
+				"lasts more than the threshold (100 ms by default)\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "off")) {
+			return "stall off\n"
+				"disable stall detection, keeping statistics and reports\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "reset")) {
+			return "stall reset\n"
+				"clear statistics and stall reports\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "show")) {
+			return "stall show [-p]\n"
+				"show event loop latency statistics and histogram\n"
+				"-p : pretty-print numbers with thousands separators\n";
+		}
+		else if (0 == ascii_strcasecmp(argv[1], "reports")) {
+			return "stall reports\n"
+				"show the most recent stall reports with the stack of\n"
+				"the main thread, as captured during the stall\n";
+		}
+	} else {
+		return
+			"stall on [ms]\n"
+			"stall off\n"
+			"stall reset\n"
+			"stall show [-p]\n"
+			"stall reports\n"
+			;
+	}
+	return NULL;
+}
+
+/* vi: set ts=4 sw=4 cindent: */
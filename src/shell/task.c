@@ -68,10 +68,12 @@ shell_exec_task_list(struct gnutella_shell *sh,
 	shell_write(sh, "100~\n");
 	if (opt_s != NULL) {
 		shell_write(sh,
-			"T  Tasks Run-Q Sleep-Q Ended Slice Period  Run-time Name\n");
+			"T  Tasks Run-Q Sleep-Q Ended Slice Period  Run-time  CPU-time "
+			"Name\n");
 	} else {
 		shell_write(sh,
-			"T  Flag S Work-Q Handled St Progress  Run-time Name (Sched)\n");
+			"T  Flag S Work-Q Handled St Progress  Run-time  CPU-time "
+			"Longest Over Name (Sched)\n");
 	}
 
 	info = opt_s != NULL ? bg_sched_info_list() : bg_info_list();
@@ -110,6 +112,7 @@ shell_exec_task_list(struct gnutella_shell *sh,
 			else
 				str_catf(s, "%6s ", "-");
 			str_catf(s, "%9s ", compact_time_ms(bsi->wtime));
+			str_catf(s, "%9s ", compact_time_ms(bsi->ctime));
 			str_catf(s, "\"%s\"", bsi->name);
 		} else {
 			bgtask_info_t *bi = sl->data;
@@ -141,6 +144,9 @@ shell_exec_task_list(struct gnutella_shell *sh,
 			str_catf(s, "%-2d ", bi->stepcnt);
 			str_catf(s, "%2d:%-5d ", bi->step, bi->seqno);
 			str_catf(s, "%9s ", compact_time_ms(bi->wtime));
+			str_catf(s, "%9s ", compact_time_ms(bi->ctime));
+			str_catf(s, "%'7u ", bi->max_run / 1000);
+			str_catf(s, "%4u ", bi->overruns);
 			str_catf(s, "\"%s\"%*s(%s)", bi->tname,
 				(int) (maxlen - vstrlen(bi->tname)), "", bi->sname);
 		}
@@ -200,7 +206,9 @@ shell_help_task(int argc, const char *argv[])
 	if (argc > 1) {
 		if (0 == ascii_strcasecmp(argv[1], "list")) {
 			return "task list [-s]\n"
-				"list all running background tasks\n"
+				"list all running background tasks, with the wall-clock\n"
+				"and CPU time they used, their longest run in ms and the\n"
+				"amount of runs that exceeded their time budget\n"
 				"-s: show schedulers instead of tasks\n";
 		}
 	} else {